@@ -20,8 +20,13 @@ namespace xr
     path_finder_.setGradientRef(gradient_ref_);
     path_finder_.setPassability(std::make_shared<AllTraversable>());
   }
+
+  void ActiveContours::reset() {
+    path_finder_.resize(data_->initial.size());
+    setGradientRef(&data_->gradient);
+  }
   
-  void ActiveContours::setGradientRef(Matrix<double>* grad_ref) {
+  void ActiveContours::setGradientRef(matr* grad_ref) {
     gradient_ref_ = grad_ref;
     path_finder_.setGradientRef(gradient_ref_);
   }
@@ -40,7 +45,7 @@ namespace xr
 
   contour_t& ActiveContours::run(contour_t& contour, int radius, int max_iters) {
     // TODO попробовать обойтись без создания image_dbl
-    matd image_dbl(std::move(data_->initial.to<double>().scale(0.0, 1.0)));
+    matr image_dbl(std::move(data_->initial.to<real_t>().scale(0.0, 1.0)));
     gradient_ref_->scale(0.0, 1.0);
 
     size_t begin_size = contour.size();
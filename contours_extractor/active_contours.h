@@ -20,15 +20,18 @@ namespace xr
     Data::HardPtr data_;
     PathFinder path_finder_;
     int simplification_degree_;
-    Matrix<double>* gradient_ref_;
+    matr* gradient_ref_;
     bool enable_uniform_points_distribution_;
     double energies_[Energy::Size];
 
   public:
     ActiveContours(Data::HardPtr data);
 
+    //     data_ ( Data::assign)
+    void reset();
+
     //  ,   (  -   data_)
-    void setGradientRef(Matrix<double>* grad_ref);
+    void setGradientRef(matr* grad_ref);
 
     //       
     //     
@@ -5,6 +5,49 @@
 
 namespace xr
 {
+  namespace
+  {
+    void resetRegionInfo(RegionInfo& region) {
+      region.pixels_in_boundary_sides[0] = 0;
+      region.pixels_in_boundary_sides[1] = 0;
+      region.pixels_in_boundary_sides[2] = 0;
+      region.pixels_in_boundary_sides[3] = 0;
+    }
+
+    // вклад точки области в гистограмму и касание краев
+    void addRegionPixel(const point_t& e, const Image& initial_ver, RegionInfo& region) {
+      int byte = static_cast<int>(initial_ver.byte(e));
+
+      region.histogram[byte] += 1;
+      if (e.x <= 1 || e.y <= 1 || (initial_ver.width() - e.x) <= 2 || (initial_ver.height() - e.y) <= 2) {
+        ++region.amount_pixels_in_boundary_region;
+      }
+
+      if (e.x <= 1) ++region.pixels_in_boundary_sides[0];
+      else if (e.y <= 1) ++region.pixels_in_boundary_sides[1];
+      else if (initial_ver.width() - e.x <= 2) ++region.pixels_in_boundary_sides[2];
+      else if (initial_ver.height() - e.y <= 2) ++region.pixels_in_boundary_sides[3];
+    }
+
+    // статистики по накопленной гистограмме
+    void finishRegionInfo(RegionInfo& region) {
+      double deviation = 0;
+      int sum = 0, variation = 0;
+      for (size_t i = 0; i<region.histogram.size(); ++i) {
+        variation += static_cast<int>(i*i)*region.histogram[i];
+        sum += static_cast<int>(i)*region.histogram[i];
+      }
+
+      region.medium_color = uint8_t(sum / region.size);
+      region.dispersion = double(variation) / region.size - math::sqr(region.medium_color);
+      for (size_t i = 0; i < region.histogram.size(); ++i) {
+        deviation += region.histogram[i] * math::sqr(i - region.medium_color);
+      }
+
+      region.standart_deviation = sqrt(deviation / region.size);
+    }
+  }
+
   /* Report */
   Report::Report() :
     wtw(0),
@@ -61,7 +104,7 @@ namespace xr
     return dictionary;
   }
 
-  Report createReport(const mati& marked, const Image& binary_ver, const contours_t& contours, const matd& edges, uint8_t threshold, regions_t& regs) {
+  Report createReport(const mati& marked, const BinaryImage& binary_ver, const contours_t& contours, const matr& edges, uint8_t threshold, const regions_t& regs) {
     Report report;
     report.size = marked.width()*marked.height();
 
@@ -74,18 +117,24 @@ namespace xr
     }
     report.average_value_grad_on_edge /= (report.number_of_edge_points + 1);
 
-    // countWhitePointsInBinary
-    int nom = 0;
-    for (int i = 1; i < binary_ver.width() - 1; ++i) {
-      for (int j = 1; j < binary_ver.height() - 1; ++j) {
-        if (!marked(i, j)) ++nom;
-        if (binary_ver.byte(i, j) == 255) {
-          ++report.count_white_points_in_binary;
-          if (marked(i, j)) {
-            ++regs[marked(i, j) - 1].count_white_points_in_binary;
-          }
-        }
-      }
+    // countWhitePointsInBinary - точки без рамки шириной 1, число белых точек областей уже собрано в colorize
+    int width = marked.width(), height = marked.height();
+    report.count_white_points_in_binary = binary_ver.sum(rect_t(1, width - 2, 1, height - 2));
+
+    // nom - точки без рамки вне областей; области могут выходить на рамку
+    int nom = (width - 2) * (height - 2);
+    for (auto& region : regs) {
+      nom -= region.size;
+    }
+
+    for (int i = 0; i < width; ++i) {
+      if (marked(i, 0)) ++nom;
+      if (marked(i, height - 1)) ++nom;
+    }
+
+    for (int j = 1; j < height - 1; ++j) {
+      if (marked(0, j)) ++nom;
+      if (marked(width - 1, j)) ++nom;
     }
 
     report.wtw = 1.0 - double(nom) / report.count_white_points_in_binary;
@@ -128,10 +177,7 @@ namespace xr
 
   void collectRegionInfo(const points_t& points, const Image* initial_ver, RegionInfo& region) {
     region.points = points;
-    region.pixels_in_boundary_sides[0] = 0;
-    region.pixels_in_boundary_sides[1] = 0;
-    region.pixels_in_boundary_sides[2] = 0;
-    region.pixels_in_boundary_sides[3] = 0;
+    resetRegionInfo(region);
 
     region.size = static_cast<int>(points.size());
     region.some_point = points.front();
@@ -139,51 +185,72 @@ namespace xr
 
     if (initial_ver) {
       for (auto& e : points) {
-        int byte = static_cast<int>(initial_ver->byte(e));
-
-        region.histogram[byte] += 1;
-        if (e.x <= 1 || e.y <= 1 || (initial_ver->width() - e.x) <= 2 || (initial_ver->height() - e.y) <= 2) {
-          ++region.amount_pixels_in_boundary_region;
-        }
-
-        if (e.x <= 1) ++region.pixels_in_boundary_sides[0];
-        else if (e.y <= 1) ++region.pixels_in_boundary_sides[1];
-        else if (initial_ver->width() - e.x <= 2) ++region.pixels_in_boundary_sides[2];
-        else if (initial_ver->height() - e.y <= 2) ++region.pixels_in_boundary_sides[3];
+        addRegionPixel(e, *initial_ver, region);
       }
 
-      double deviation = 0;
-      int sum = 0, variation = 0;
-      for (size_t i = 0; i<region.histogram.size(); ++i) {
-        variation += static_cast<int>(i*i)*region.histogram[i];
-        sum += static_cast<int>(i)*region.histogram[i];
-      }
-
-      region.medium_color = uint8_t(sum / region.size);
-      region.dispersion = double(variation) / region.size - math::sqr(region.medium_color);
-      for (size_t i = 0; i < region.histogram.size(); ++i) {
-        deviation += region.histogram[i] * math::sqr(i - region.medium_color);
-      }
-
-      region.standart_deviation = sqrt(deviation / region.size);
+      finishRegionInfo(region);
     }
   }
 
-  mati colorize(const Image& image, const Image& initial_ver, regions_t* regions) {
+  mati colorize(const Image& image, const Image& initial_ver, regions_t* regions, const BinaryImage* binary_ver) {
+    const int width = image.width(), height = image.height();
+    auto background = [&](int x, int y) {
+      return image.data()[x + (height - y - 1) * width] == 0;
+    };
+
+    // заливка (4-связная, тот же порядок обхода, что у Image::getPointsRegion) сразу собирает
+    // точки и статистики области, отметки marked служат признаком посещения
     int counter = 1;
     mati marked(image.size(), 0);
-    for (int j = 1; j < image.height() - 1; ++j) {
-      for (int i = 1; i < image.width() - 1; ++i) {
-        if (image.byte(i, j) == 0 && marked(i, j) == 0) {
-          auto points = image.getPointsRegion(i, j);
-          for (auto &it : points) {
-            marked(it) = counter; // flood fill
+    points_t stack;
+    for (int j = 1; j < height - 1; ++j) {
+      for (int i = 1; i < width - 1; ++i) {
+        if (!background(i, j) || marked(i, j) != 0) continue;
+
+        RegionInfo* region = nullptr;
+        if (regions) {
+          regions->emplace_back(counter);
+          region = &regions->back();
+          resetRegionInfo(*region);
+          region->some_point = point_t(i, j);
+          region->bound_rect = rect_t(i, i, j, j);
+        }
+
+        stack.assign(1, point_t(i, j));
+        marked(i, j) = counter;
+        do {
+          auto cur = stack.back();
+          stack.pop_back();
+
+          if (region) {
+            region->points.push_back(cur);
+            addRegionPixel(cur, initial_ver, *region);
+
+            auto& rect = region->bound_rect;
+            if (rect.top < cur.y) rect.top = cur.y;
+            if (rect.left > cur.x) rect.left = cur.x;
+            if (rect.right < cur.x) rect.right = cur.x;
+            if (rect.bottom > cur.y) rect.bottom = cur.y;
+
+            if (binary_ver && cur.x > 0 && cur.y > 0 && cur.x < width - 1 && cur.y < height - 1 && binary_ver->get(cur.x, cur.y)) {
+              ++region->count_white_points_in_binary;
+            }
           }
 
-          if (regions) {
-            regions->emplace_back(counter++);
-            collectRegionInfo(points, &initial_ver, regions->back());
+          for (int k = 0; k < Connectivity::Four; ++k) {
+            int x = cur.x + math::dx[k];
+            int y = cur.y + math::dy[k];
+            if (marked.isCorrect(x, y) && background(x, y) && marked(x, y) == 0) {
+              marked(x, y) = counter;
+              stack.emplace_back(x, y);
+            }
           }
+        } while (!stack.empty());
+
+        if (region) {
+          region->size = static_cast<int>(region->points.size());
+          finishRegionInfo(*region);
+          ++counter;
         }
       }
     }
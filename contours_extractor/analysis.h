@@ -2,6 +2,7 @@
 #include <map>
 #include "defs.h"
 #include "image.h"
+#include "binary_image.h"
 
 namespace xr
 {
@@ -62,7 +63,9 @@ namespace xr
   // binary_ver -   
   // final_ver -  
   //  final_ver     OBJECT_REG
-  Report createReport(const mati& marked, const Image& binary_ver, const contours_t& contours, const matd& edges, uint8_t threshold, regions_t& regs);
+  // regs -  colorize(.., binary_ver)    (    ),
+  //     
+  Report createReport(const mati& marked, const BinaryImage& binary_ver, const contours_t& contours, const matr& edges, uint8_t threshold, const regions_t& regs);
 
   double calcMetricsQualityAllocation(const Report& report, int metric_type);
 
@@ -71,7 +74,8 @@ namespace xr
   //    ,   -    .
   // @ image -     .
   // @ initialVer -  () .
-  // @ regions -  .
+  // @ regions -   (     ).
+  // @ binary_ver -  ,    count_white_points_in_binary (   1).
   // @ return -   (  ), 0 -  .
-  mati colorize(const Image& image, const Image& initial_ver, regions_t* regions = nullptr);
+  mati colorize(const Image& image, const Image& initial_ver, regions_t* regions = nullptr, const BinaryImage* binary_ver = nullptr);
 }
@@ -0,0 +1,264 @@
+﻿#include <algorithm>
+#include "binary_image.h"
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace xr
+{
+  namespace
+  {
+    using word_t = BinaryImage::word_t;
+
+    int popcount(word_t word) {
+#ifdef _MSC_VER
+      return static_cast<int>(__popcnt64(word));
+#else
+      return __builtin_popcountll(word);
+#endif
+    }
+
+    struct And {
+      word_t operator () (word_t a, word_t b) const {
+        return a & b;
+      }
+    };
+
+    struct Or {
+      word_t operator () (word_t a, word_t b) const {
+        return a | b;
+      }
+    };
+
+    // шаг радиуса 1 вдоль строк: op(x - 1, x, x + 1), за краями строки - pad
+    template<class Op>
+    void rowStep(const word_t* src, word_t* dst, int height, int stride, word_t tail, word_t pad, Op op) {
+      for (int y = 0; y < height; ++y) {
+        const word_t* in = src + y * stride;
+        word_t* out = dst + y * stride;
+        for (int k = 0; k < stride; ++k) {
+          word_t cur = (k == stride - 1) ? (in[k] & tail) | (pad & ~tail) : in[k];
+          word_t prev = (k > 0) ? in[k - 1] : pad;
+          word_t next = (k + 1 < stride) ? in[k + 1] : pad;
+          out[k] = op(op(cur, (cur << 1) | (prev >> 63)), (cur >> 1) | (next << 63));
+        }
+
+        out[stride - 1] &= tail;
+      }
+    }
+
+    // шаг радиуса 1 вдоль столбцов: op(y - 1, y, y + 1) целыми словами
+    template<class Op>
+    void columnStep(const word_t* src, word_t* dst, int height, int stride, word_t pad, Op op) {
+      for (int y = 0; y < height; ++y) {
+        const word_t* cur = src + y * stride;
+        const word_t* prev = (y > 0) ? cur - stride : nullptr;
+        const word_t* next = (y + 1 < height) ? cur + stride : nullptr;
+        word_t* out = dst + y * stride;
+        for (int k = 0; k < stride; ++k) {
+          out[k] = op(op(prev ? prev[k] : pad, cur[k]), next ? next[k] : pad);
+        }
+      }
+    }
+
+    // квадрат радиуса radius - radius шагов по строкам и radius шагов по столбцам
+    template<class Op>
+    void morphology(std::vector<word_t>& bits, int height, int stride, word_t tail, int radius, word_t pad, Op op) {
+      std::vector<word_t> temp(bits.size());
+      for (int i = 0; i < radius; ++i) {
+        rowStep(bits.data(), temp.data(), height, stride, tail, pad, op);
+        bits.swap(temp);
+      }
+
+      for (int i = 0; i < radius; ++i) {
+        columnStep(bits.data(), temp.data(), height, stride, pad, op);
+        bits.swap(temp);
+      }
+    }
+
+    // точки строки с x из [begin, end)
+    std::vector<word_t> rangeMask(int stride, int begin, int end) {
+      std::vector<word_t> mask(stride, 0);
+      for (int x = begin; x < end; ++x) {
+        mask[x / BinaryImage::word_bits] |= word_t(1) << (x % BinaryImage::word_bits);
+      }
+
+      return mask;
+    }
+  }
+
+  BinaryImage::BinaryImage(int width, int height) {
+    recreate(width, height);
+    clear(false);
+  }
+
+  BinaryImage::BinaryImage(const Image& src, uint8_t threshold) {
+    assign(src, threshold);
+  }
+
+  void BinaryImage::recreate(int width, int height) {
+    width_ = width;
+    height_ = height;
+    stride_ = (width + word_bits - 1) / word_bits;
+    bits_.resize(stride_ * height_);
+  }
+
+  BinaryImage::word_t BinaryImage::tailMask() const {
+    int used = width_ % word_bits;
+    return used ? (word_t(1) << used) - 1 : ~word_t(0);
+  }
+
+  BinaryImage& BinaryImage::assign(const Image& src, uint8_t threshold) {
+    recreate(src.width(), src.height());
+    for (int y = 0; y < height_; ++y) {
+      const uint8_t* pixels = src.data() + (height_ - y - 1) * width_;
+      word_t* out = bits_.data() + y * stride_;
+      for (int k = 0; k < stride_; ++k) {
+        int begin = k * word_bits;
+        int end = std::min(begin + word_bits, width_);
+
+        word_t word = 0;
+        for (int x = begin; x < end; ++x) {
+          word |= word_t(pixels[x] > threshold) << (x - begin);
+        }
+
+        out[k] = word;
+      }
+    }
+
+    return *this;
+  }
+
+  void BinaryImage::to(Image& dst) const {
+    if (dst.width() != width_ || dst.height() != height_) {
+      dst = Image(width_, height_);
+    }
+
+    for (int y = 0; y < height_; ++y) {
+      uint8_t* pixels = dst.row(y);
+      const word_t* in = line(y);
+      for (int x = 0; x < width_; ++x) {
+        pixels[x] = ((in[x / word_bits] >> (x % word_bits)) & 1) ? 255 : 0;
+      }
+    }
+  }
+
+  Image BinaryImage::toImage() const {
+    Image dst(width_, height_);
+    to(dst);
+    return dst;
+  }
+
+  uint8_t BinaryImage::neighborhood(int x, int y) const {
+    // точки x - 1, x, x + 1 строки в битах 0, 1, 2
+    auto triple = [this, x](int y) -> word_t {
+      if (y < 0 || y >= height_) return 0;
+
+      const word_t* in = line(y);
+      if (x == 0) return (in[0] << 1) & 7;
+
+      int k = (x - 1) / word_bits, shift = (x - 1) % word_bits;
+      word_t word = in[k] >> shift;
+      if (shift > word_bits - 3 && k + 1 < stride_) {
+        word |= in[k + 1] << (word_bits - shift);
+      }
+
+      return word & 7;
+    };
+
+    word_t top = triple(y - 1), middle = triple(y), bottom = triple(y + 1);
+    return static_cast<uint8_t>(
+      top |
+      ((middle >> 2) & 1) << 3 |
+      ((bottom >> 2) & 1) << 4 |
+      ((bottom >> 1) & 1) << 5 |
+      (bottom & 1) << 6 |
+      (middle & 1) << 7);
+  }
+
+  int BinaryImage::sum() const {
+    int count = 0;
+    for (auto word : bits_) {
+      count += popcount(word);
+    }
+
+    return count;
+  }
+
+  int BinaryImage::sum(const rect_t& roi) const {
+    int count = 0;
+    auto mask = rangeMask(stride_, roi.left, roi.right + 1);
+    int first = roi.left / word_bits, last = roi.right / word_bits;
+    for (int y = roi.bottom; y <= roi.top; ++y) {
+      const word_t* in = line(y);
+      for (int k = first; k <= last; ++k) {
+        count += popcount(in[k] & mask[k]);
+      }
+    }
+
+    return count;
+  }
+
+  BinaryImage& BinaryImage::clear(bool value) {
+    std::fill(bits_.begin(), bits_.end(), value ? ~word_t(0) : word_t(0));
+    if (value) {
+      for (int y = 0; y < height_; ++y) {
+        bits_[y * stride_ + stride_ - 1] &= tailMask();
+      }
+    }
+
+    return *this;
+  }
+
+  BinaryImage& BinaryImage::erode(int radius) {
+    if (width_ <= 2 * radius || height_ <= 2 * radius) return *this;
+
+    std::vector<word_t> eroded(bits_);
+    morphology(eroded, height_, stride_, tailMask(), radius, ~word_t(0), And());
+
+    // поле по краям не меняется
+    auto inner = rangeMask(stride_, radius, width_ - radius);
+    for (int y = radius, n = height_ - radius; y < n; ++y) {
+      word_t* out = bits_.data() + y * stride_;
+      const word_t* in = eroded.data() + y * stride_;
+      for (int k = 0; k < stride_; ++k) {
+        out[k] &= in[k] | ~inner[k];
+      }
+    }
+
+    return *this;
+  }
+
+  BinaryImage& BinaryImage::dilate(int radius) {
+    if (width_ <= 2 * radius || height_ <= 2 * radius) return *this;
+
+    // расширяются только точки вне поля
+    std::vector<word_t> grown(bits_.size(), 0);
+    auto inner = rangeMask(stride_, radius, width_ - radius);
+    for (int y = radius, n = height_ - radius; y < n; ++y) {
+      const word_t* in = bits_.data() + y * stride_;
+      word_t* out = grown.data() + y * stride_;
+      for (int k = 0; k < stride_; ++k) {
+        out[k] = in[k] & inner[k];
+      }
+    }
+
+    morphology(grown, height_, stride_, tailMask(), radius, 0, Or());
+    for (size_t i = 0; i < bits_.size(); ++i) {
+      bits_[i] |= grown[i];
+    }
+
+    return *this;
+  }
+
+  BinaryImage& BinaryImage::closing(int radius) {
+    dilate(radius);
+    return erode(radius);
+  }
+
+  BinaryImage& BinaryImage::opening(int radius) {
+    erode(radius);
+    return dilate(radius);
+  }
+}
@@ -0,0 +1,82 @@
+﻿#pragma once
+#include <vector>
+#include <cstdint>
+#include "image.h"
+
+namespace xr
+{
+  // Бинарное изображение, 1 бит на пиксель: строки из 64-битных слов, биты за шириной строки - нули.
+  // Морфология и подсчет работают сразу со словами; памяти в 8 раз меньше, чем у Image
+  class BinaryImage {
+  public:
+    using word_t = uint64_t;
+    static const int word_bits = 64;
+
+  private:
+    std::vector<word_t> bits_;
+    int width_ = 0, height_ = 0;
+    int stride_ = 0; // слов в строке
+
+    void recreate(int width, int height);
+    word_t tailMask() const;
+
+  public:
+    BinaryImage() = default;
+    BinaryImage(int width, int height);
+    explicit BinaryImage(const Image& src, uint8_t threshold = 254);
+
+    // бит установлен, если яркость больше threshold (по умолчанию - белые точки);
+    // буфер переиспользуется, если его хватает
+    BinaryImage& assign(const Image& src, uint8_t threshold = 254);
+
+    // установленные биты - 255, остальные - 0
+    void to(Image& dst) const;
+    Image toImage() const;
+
+    int width() const {
+      return width_;
+    }
+
+    int height() const {
+      return height_;
+    }
+
+    cv::Size size() const {
+      return cv::Size(width_, height_);
+    }
+
+    bool isCorrect(int x, int y) const {
+      return x >= 0 && y >= 0 && x < width_ && y < height_;
+    }
+
+    const word_t* line(int y) const {
+      return bits_.data() + y * stride_;
+    }
+
+    bool get(int x, int y) const {
+      return (line(y)[x / word_bits] >> (x % word_bits)) & 1;
+    }
+
+    void set(int x, int y, bool value) {
+      word_t& word = bits_[y * stride_ + x / word_bits];
+      word_t bit = word_t(1) << (x % word_bits);
+      word = value ? (word | bit) : (word & ~bit);
+    }
+
+    // бит i - сосед (x + math::cdx[i], y + math::cdy[i]), за краем изображения - 0
+    uint8_t neighborhood(int x, int y) const;
+
+    // число установленных точек (popcount по словам), во всем изображении или в roi (границы включительно)
+    int sum() const;
+    int sum(const rect_t& roi) const;
+
+    BinaryImage& clear(bool value);
+
+    // то же, что Image::erode/dilate/closing/opening для квадрата радиуса radius (и то же поле по краям),
+    // шаг радиуса 1 - три сдвига и две логические операции на слово
+    BinaryImage& erode(int radius);
+    BinaryImage& dilate(int radius);
+    BinaryImage& closing(int radius);
+    BinaryImage& opening(int radius);
+  };
+}
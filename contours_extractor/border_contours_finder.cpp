@@ -0,0 +1,103 @@
+﻿#include "border_contours_finder.h"
+#include "analysis.h"
+
+namespace xr
+{
+  namespace
+  {
+    /* Обход внешней границы области id, first - ее первая точка при построчном просмотре.
+       Обходятся точки, не принадлежащие области, но соседние с ней (8-связно), -
+       это граница между областями, по которой проходят контуры остальных поисковиков.
+       Поиск соседа начинается от последней проверенной внешней точки (обход Мура),
+       остановка - при повторе первого шага из начальной точки. */
+    contour_t traceOuterBorder(const mati& marked, int id, const point_t& first) {
+      auto inside = [&](int x, int y) {
+        return marked.isCorrect(x, y) && marked(x, y) == id;
+      };
+
+      auto covered = [&](int x, int y) {
+        if (!marked.isCorrect(x, y)) return false;
+        if (marked(x, y) == id) return true;
+
+        for (int i = 0; i < 8; ++i) {
+          if (inside(x + math::cdx[i], y + math::cdy[i])) return true;
+        }
+
+        return false;
+      };
+
+      // выше и левее first точек области нет, поэтому (x - 1, y - 1) - первая точка обхода,
+      // а ее сосед слева заведомо внешний
+      const point_t start(first.x - 1, first.y - 1);
+      point_t cur = start, second;
+      int back = 7;
+
+      contour_t dst;
+      while (true) {
+        int k = 1;
+        point_t next;
+        for (; k <= 8; ++k) {
+          int d = (back + k) & 7;
+          next = point_t(cur.x + math::cdx[d], cur.y + math::cdy[d]);
+          if (covered(next.x, next.y)) break;
+        }
+
+        if (k > 8) break; // одиночная точка
+
+        if (dst.empty()) second = next;
+        else if (cur == start && next == second) break;
+
+        dst.push_back(cur);
+
+        // последняя проверенная внешняя точка относительно новой текущей
+        int prev = (back + k - 1) & 7;
+        int dx = cur.x + math::cdx[prev] - next.x;
+        int dy = cur.y + math::cdy[prev] - next.y;
+        back = math::cindex[(dy + 1) * 3 + dx + 1];
+        cur = next;
+      }
+
+      return dst;
+    }
+  }
+
+  BorderContoursFinder::BorderContoursFinder(Data::HardPtr data) :
+    ContoursFinder(data)
+  {
+
+  }
+
+  void BorderContoursFinder::reset() {
+    // поиск путей не нужен
+  }
+
+  contours_t BorderContoursFinder::find(Image* image, SearchMode mode, int threshold) {
+    regions_t regions;
+    mati marked = colorize(*image, data_->initial, &regions);
+
+    // области пронумерованы в порядке построчного просмотра, первая встреченная точка
+    // области лежит на ее внешней границе
+    std::vector<bool> traced(regions.size() + 1, false);
+    contours_t contours;
+    for (int j = 0; j < marked.height(); ++j) {
+      const int* line = marked.line(j);
+      for (int i = 0; i < marked.width(); ++i) {
+        int id = line[i];
+        if (id == 0 || traced[id]) continue;
+
+        traced[id] = true;
+        const auto& region = regions[id - 1];
+        bool suitable = (mode == SearchMode::FilterOut && region.medium_color > threshold);
+        suitable |= (mode == SearchMode::All);
+        if (suitable) {
+          contour_t contour = traceOuterBorder(marked, id, point_t(i, j));
+          if ((mode == SearchMode::FilterOut && contour.size()>128) || mode == SearchMode::All) {
+            contours.push_back(contour);
+          }
+        }
+      }
+    }
+
+    return contours;
+  }
+}
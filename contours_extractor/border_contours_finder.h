@@ -0,0 +1,15 @@
+#pragma once
+#include "contours_finder.h"
+
+namespace xr
+{
+  // внешние границы всех областей colorize(..) за один построчный просмотр
+  // (прослеживание границ в духе Suzuki-Abe), без ключевых точек, A* и toFundamental
+  class BorderContoursFinder : public ContoursFinder {
+  public:
+    BorderContoursFinder(Data::HardPtr data);
+
+    void reset() override;
+    contours_t find(Image* image, SearchMode mode, int threshold) override;
+  };
+}
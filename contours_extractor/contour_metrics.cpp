@@ -0,0 +1,145 @@
+﻿#include <algorithm>
+#include <unordered_map>
+#include <cmath>
+#include "contour_metrics.h"
+
+namespace xr
+{
+  namespace
+  {
+    struct Accumulator {
+      size_t count = 0;
+      double sum = 0.0;
+      double sqr_sum = 0.0;
+      double max = 0.0;
+    };
+
+    // расстояния от точек src до ближайших точек индекса
+    Accumulator accumulate(const contour_t& src, const ContourIndex& index) {
+      Accumulator acc;
+      for (auto& pt : src) {
+        auto sqr = static_cast<double>(index.nearestSqr(pt));
+        auto d = sqrt(sqr);
+        acc.sum += d;
+        acc.sqr_sum += sqr;
+        acc.max = std::max(acc.max, d);
+      }
+
+      acc.count = src.size();
+      return acc;
+    }
+  }
+
+  ContourIndex::ContourIndex(const contour_t& contour) :
+    points_(contour)
+  {
+    build(0, points_.size(), 0);
+  }
+
+  void ContourIndex::build(size_t begin, size_t end, int depth) {
+    if (end - begin <= 1) return;
+
+    size_t mid = begin + (end - begin) / 2;
+    bool by_x = depth % 2 == 0;
+    std::nth_element(points_.begin() + begin, points_.begin() + mid, points_.begin() + end, [by_x](const point_t& a, const point_t& b) {
+      return by_x ? a.x < b.x : a.y < b.y;
+    });
+
+    build(begin, mid, depth + 1);
+    build(mid + 1, end, depth + 1);
+  }
+
+  void ContourIndex::nearest(size_t begin, size_t end, int depth, const point_t& pt, int64_t& best) const {
+    if (begin >= end) return;
+
+    size_t mid = begin + (end - begin) / 2;
+    auto& node = points_[mid];
+    int64_t dx = pt.x - node.x, dy = pt.y - node.y;
+    best = std::min(best, dx * dx + dy * dy);
+
+    // сначала ближняя половина, дальняя - только если разделяющая прямая ближе найденного
+    auto diff = depth % 2 == 0 ? dx : dy;
+    if (diff < 0) {
+      nearest(begin, mid, depth + 1, pt, best);
+      if (diff * diff < best) nearest(mid + 1, end, depth + 1, pt, best);
+    }
+    else {
+      nearest(mid + 1, end, depth + 1, pt, best);
+      if (diff * diff < best) nearest(begin, mid, depth + 1, pt, best);
+    }
+  }
+
+  bool ContourIndex::empty() const {
+    return points_.empty();
+  }
+
+  size_t ContourIndex::size() const {
+    return points_.size();
+  }
+
+  int64_t ContourIndex::nearestSqr(const point_t& pt) const {
+    int64_t best = INT64_MAX;
+    nearest(0, points_.size(), 0, pt, best);
+    return best;
+  }
+
+  double ContourIndex::nearest(const point_t& pt) const {
+    return sqrt(static_cast<double>(nearestSqr(pt)));
+  }
+
+  ContourMetrics compareContour(const contour_t& first, const ContourIndex& first_index,
+    const contour_t& other, const ContourIndex& other_index)
+  {
+    ContourMetrics dst;
+    if (first.empty() || other_index.empty()) {
+      return dst;
+    }
+
+    auto direct = accumulate(first, other_index);
+    auto n = static_cast<double>(direct.count);
+
+    dst.count = direct.count;
+    dst.mean_distance = direct.sum / n;
+    dst.rms_error = sqrt(direct.sqr_sum / n);
+    dst.deviation = sqrt(std::max(0.0, direct.sqr_sum / n - dst.mean_distance * dst.mean_distance));
+    dst.hausdorff = std::max(direct.max, accumulate(other, first_index).max);
+
+    return dst;
+  }
+
+  ContourMetrics compareContour(const contour_t& first, const contour_t& other) {
+    return compareContour(first, ContourIndex(first), other, ContourIndex(other));
+  }
+
+  std::vector<ContourMetrics> evaluateContours(const std::vector<ContourPair>& pairs) {
+    // различные контуры и их индексы
+    std::unordered_map<const contour_t*, int> ids;
+    std::vector<const contour_t*> contours;
+    for (auto& pair : pairs) {
+      for (auto contour : { pair.first, pair.other }) {
+        if (ids.emplace(contour, static_cast<int>(contours.size())).second) {
+          contours.push_back(contour);
+        }
+      }
+    }
+
+    int count = static_cast<int>(contours.size());
+    std::vector<ContourIndex> indexes(count);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < count; ++i) {
+      indexes[i] = ContourIndex(*contours[i]);
+    }
+
+    int size = static_cast<int>(pairs.size());
+    std::vector<ContourMetrics> dst(size);
+
+#pragma omp parallel for schedule(dynamic)
+    for (int i = 0; i < size; ++i) {
+      auto& pair = pairs[i];
+      dst[i] = compareContour(*pair.first, indexes[ids.at(pair.first)], *pair.other, indexes[ids.at(pair.other)]);
+    }
+
+    return dst;
+  }
+}
@@ -0,0 +1,53 @@
+﻿#pragma once
+#include <vector>
+#include <cstdint>
+#include "defs.h"
+
+namespace xr
+{
+  // индекс точек контура для поиска ближайшей точки: неявное k-d дерево
+  // (точки переупорядочены так, что медиана каждого отрезка - узел дерева);
+  // строится один раз на контур за O(n log n), запрос - O(log n)
+  class ContourIndex {
+  private:
+    contour_t points_;
+
+    void build(size_t begin, size_t end, int depth);
+    void nearest(size_t begin, size_t end, int depth, const point_t& pt, int64_t& best) const;
+
+  public:
+    ContourIndex() = default;
+    explicit ContourIndex(const contour_t& contour);
+
+    bool empty() const;
+    size_t size() const;
+
+    // квадрат расстояния до ближайшей точки контура (INT64_MAX для пустого индекса)
+    int64_t nearestSqr(const point_t& pt) const;
+    double nearest(const point_t& pt) const;
+  };
+
+  // отклонение контура от эталона; расстояния от точек контура до ближайших точек эталона
+  struct ContourMetrics {
+    size_t count = 0; // число сравненных точек, 0 - если один из контуров пуст
+    double mean_distance = 0.0;
+    double rms_error = 0.0;
+    double deviation = 0.0; // СКО расстояний
+    double hausdorff = 0.0; // симметричное расстояние Хаусдорфа
+  };
+
+  // все метрики за один проход по контуру и один обратный проход (для Хаусдорфа)
+  ContourMetrics compareContour(const contour_t& first, const ContourIndex& first_index,
+    const contour_t& other, const ContourIndex& other_index);
+
+  ContourMetrics compareContour(const contour_t& first, const contour_t& other);
+
+  struct ContourPair {
+    const contour_t* first;
+    const contour_t* other;
+  };
+
+  // пакетное сравнение: индекс строится один раз на каждый различный контур,
+  // пары обрабатываются параллельно
+  std::vector<ContourMetrics> evaluateContours(const std::vector<ContourPair>& pairs);
+}
@@ -14,6 +14,19 @@ namespace xr
   
   }
 
+  void ContoursFinder::reset() {
+    if (!path_finder_) {
+      path_finder_ = std::make_shared<PathFinder>(data_->initial.size());
+    }
+    else {
+      path_finder_->resize(data_->initial.size());
+    }
+
+    path_finder_->setGradientRef(&data_->gradient);
+    path_finder_->scaleGradient(0.0, 255.0);
+    path_finder_->setFactor(0.0);
+  }
+
   contour_t ContoursFinder::initialContour(const points_t& key_points) {
     assert(path_finder_ != nullptr);
 
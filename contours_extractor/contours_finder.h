@@ -23,6 +23,9 @@ namespace xr
     ContoursFinder(Data::HardPtr data);
     ~ContoursFinder();
 
+    // подготовка к работе с текущим содержимым data_ (после Data::assign)
+    virtual void reset();
+
     virtual contours_t find(Image* image, SearchMode mode, int threshold) = 0;
   };
 }
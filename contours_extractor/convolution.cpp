@@ -0,0 +1,235 @@
+﻿#include "convolution.h"
+#include <cmath>
+#include <algorithm>
+#include "except.h"
+
+namespace xr
+{
+  namespace
+  {
+    // индекс точки за краем -> [0, n); -1 - точки нет (Border::Zero)
+    int borderIndex(int k, int n, Border border) {
+      if (k >= 0 && k < n) {
+        return k;
+      }
+
+      switch (border) {
+      case Border::Zero:
+        return -1;
+      case Border::Replicate:
+        return k < 0 ? 0 : n - 1;
+      case Border::Reflect:
+        k = k < 0 ? -k : 2 * (n - 1) - k;
+        break;
+      default:
+        k = k < 0 ? -k : 2 * n - 1 - k;
+        break;
+      }
+
+      // поля шире изображения
+      return std::min(std::max(k, 0), n - 1);
+    }
+
+    /* kernel(i, j) = row[i] * column[j]: опорный элемент - наибольший по модулю,
+       остальные проверяются с относительной точностью */
+    bool decompose(const matd& kernel, std::vector<double>& row, std::vector<double>& column) {
+      const int n = kernel.width();
+      int pi = 0, pj = 0;
+      for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+          if (std::abs(kernel(i, j)) > std::abs(kernel(pi, pj))) {
+            pi = i;
+            pj = j;
+          }
+        }
+      }
+
+      const double pivot = kernel(pi, pj);
+      if (pivot == 0.0) {
+        return false;
+      }
+
+      row.resize(n);
+      column.resize(n);
+      for (int k = 0; k < n; ++k) {
+        row[k] = kernel(k, pj) / pivot;
+        column[k] = kernel(pi, k);
+      }
+
+      const double eps = 1e-12 * std::abs(pivot);
+      for (int i = 0; i < n; ++i) {
+        for (int j = 0; j < n; ++j) {
+          if (std::abs(row[i] * column[j] - kernel(i, j)) > eps) {
+            return false;
+          }
+        }
+      }
+
+      return true;
+    }
+
+    struct Plan {
+      const matd* kernel;
+      int radius;
+      bool separable;
+      std::vector<double> row, column;
+      std::vector<double> acc; // раздельное - проход по столбцам (с полями), иначе - строка результата
+      int shared = -1;         // раздельное с тем же столбцом, что у ядра shared, - проход по столбцам общий
+    };
+  }
+
+  Convolution::Convolution(const Image& src, int radius, Border border) :
+    width_(src.width()),
+    height_(src.height()),
+    radius_(radius),
+    stride_(src.width() + 2 * radius)
+  {
+    padded_.assign(stride_ * (height_ + 2 * radius_), 0.0);
+    for (int y = 0; y < height_; ++y) {
+      const uint8_t* row = src.data() + (height_ - y - 1) * width_;
+      std::copy(row, row + width_, line(y) + radius_);
+    }
+
+    pad(border);
+  }
+
+  Convolution::Convolution(const matd& src, int radius, Border border) :
+    width_(src.width()),
+    height_(src.height()),
+    radius_(radius),
+    stride_(src.width() + 2 * radius)
+  {
+    padded_.assign(stride_ * (height_ + 2 * radius_), 0.0);
+    for (int y = 0; y < height_; ++y) {
+      std::copy(src.line(y), src.line(y) + width_, line(y) + radius_);
+    }
+
+    pad(border);
+  }
+
+  void Convolution::pad(Border border) {
+    // сначала боковые поля строк изображения, затем строки полей - копии уже дополненных строк
+    for (int y = 0; y < height_; ++y) {
+      double* row = line(y) + radius_;
+      for (int x = -radius_; x < 0; ++x) {
+        const int k = borderIndex(x, width_, border);
+        row[x] = k < 0 ? 0.0 : row[k];
+      }
+
+      for (int x = width_; x < width_ + radius_; ++x) {
+        const int k = borderIndex(x, width_, border);
+        row[x] = k < 0 ? 0.0 : row[k];
+      }
+    }
+
+    auto padRow = [&](int y) {
+      const int k = borderIndex(y, height_, border);
+      if (k < 0) {
+        std::fill(line(y), line(y) + stride_, 0.0);
+      }
+      else {
+        std::copy(line(k), line(k) + stride_, line(y));
+      }
+    };
+
+    for (int y = -radius_; y < 0; ++y) {
+      padRow(y);
+    }
+
+    for (int y = height_; y < height_ + radius_; ++y) {
+      padRow(y);
+    }
+  }
+
+  template<typename T>
+  void Convolution::apply(const std::vector<matd>& kernels, const std::vector<Matrix<T>*>& dst) const {
+    std::vector<Plan> plans(kernels.size());
+    for (size_t k = 0; k < kernels.size(); ++k) {
+      const matd& kernel = kernels[k];
+      if (kernel.width() != kernel.height() || kernel.width() % 2 == 0 || kernel.width() > 2 * radius_ + 1) {
+        throw InvalidParameterException("kernel");
+      }
+
+      auto& plan = plans[k];
+      plan.kernel = &kernel;
+      plan.radius = kernel.width() / 2;
+      plan.separable = decompose(kernel, plan.row, plan.column);
+      for (size_t j = 0; plan.separable && j < k; ++j) {
+        if (plans[j].separable && plans[j].shared < 0 && plans[j].column == plan.column) {
+          plan.shared = static_cast<int>(j);
+          break;
+        }
+      }
+
+      if (plan.shared < 0) {
+        plan.acc.resize(plan.separable ? stride_ : width_);
+      }
+      dst[k]->recreate(width_, height_);
+    }
+
+    std::vector<double> out(width_);
+    for (int y = 0; y < height_; ++y) {
+      for (auto& plan : plans) {
+        std::fill(plan.acc.begin(), plan.acc.end(), 0.0);
+      }
+
+      // строки окна - внешний цикл, все ядра берут строку, пока она в кэше
+      for (int dy = -radius_; dy <= radius_; ++dy) {
+        const double* src = padded_.data() + (y + radius_ + dy) * stride_;
+        for (auto& plan : plans) {
+          const int r = plan.radius;
+          if (dy < -r || dy > r || plan.shared >= 0) continue;
+
+          double* acc = plan.acc.data();
+          if (plan.separable) {
+            const double w = plan.column[dy + r];
+            if (w == 0.0) continue;
+
+            for (int x = 0; x < stride_; ++x) {
+              acc[x] += w * src[x];
+            }
+          }
+          else {
+            for (int dx = -r; dx <= r; ++dx) {
+              const double w = (*plan.kernel)(dx + r, dy + r);
+              if (w == 0.0) continue;
+
+              const double* s = src + radius_ + dx;
+              for (int x = 0; x < width_; ++x) {
+                acc[x] += w * s[x];
+              }
+            }
+          }
+        }
+      }
+
+      for (size_t k = 0; k < plans.size(); ++k) {
+        const auto& plan = plans[k];
+        const double* acc = plan.shared < 0 ? plan.acc.data() : plans[plan.shared].acc.data();
+        if (plan.separable) {
+          const int r = plan.radius;
+          std::fill(out.begin(), out.end(), 0.0);
+          for (int dx = -r; dx <= r; ++dx) {
+            const double w = plan.row[dx + r];
+            if (w == 0.0) continue;
+
+            const double* s = acc + radius_ + dx;
+            for (int x = 0; x < width_; ++x) {
+              out[x] += w * s[x];
+            }
+          }
+
+          acc = out.data();
+        }
+
+        T* row = dst[k]->line(y);
+        for (int x = 0; x < width_; ++x) {
+          row[x] = static_cast<T>(acc[x]);
+        }
+      }
+    }
+  }
+
+  template void Convolution::apply<double>(const std::vector<matd>&, const std::vector<Matrix<double>*>&) const;
+  template void Convolution::apply<float>(const std::vector<matd>&, const std::vector<Matrix<float>*>&) const;
+}
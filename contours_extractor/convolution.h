@@ -0,0 +1,45 @@
+﻿#pragma once
+#include <vector>
+#include "image.h"
+#include "matrix.h"
+
+namespace xr
+{
+  // что считается лежащим за краем изображения
+  enum class Border {
+    Mirror,    // сверху и слева без повтора края (-1 -> 1), снизу и справа с повтором (n -> n - 1)
+    Reflect,   // без повтора края с обеих сторон: cb|abcd|cb
+    Replicate, // повтор края: aa|abcd|dd
+    Zero       // нули, т.е. точки за краем не учитываются
+  };
+
+  /* Свёртка с ядрами не больше (2 * radius + 1) x (2 * radius + 1), kernel(dx + r, dy + r) - вес точки
+     (x + dx, y + dy). Поля добавляются один раз в конструкторе. Ядро ранга 1 раскладывается на столбец
+     и строку и считается двумя одномерными проходами, остальные - по ненулевым отводам окна.
+     Несколько ядер считаются за один проход: каждая строка окна читается один раз для всех */
+  class Convolution {
+    std::vector<double> padded_;
+    int width_ = 0, height_ = 0;
+    int radius_ = 0;
+    int stride_ = 0; // ширина строки с полями
+
+    double* line(int y) {
+      return padded_.data() + (y + radius_) * stride_;
+    }
+
+    void pad(Border border);
+
+  public:
+    Convolution(const Image& src, int radius, Border border = Border::Mirror);
+    Convolution(const matd& src, int radius, Border border = Border::Mirror);
+
+    // dst[k] - отклик kernels[k]; буферы dst переиспользуются, если их хватает
+    template<typename T>
+    void apply(const std::vector<matd>& kernels, const std::vector<Matrix<T>*>& dst) const;
+
+    template<typename T>
+    void apply(const matd& kernel, Matrix<T>& dst) const {
+      apply(std::vector<matd>(1, kernel), std::vector<Matrix<T>*>(1, &dst));
+    }
+  };
+}
@@ -13,8 +13,18 @@ using Double = std::numeric_limits<double>;
 template<class T>
 class Type : public std::numeric_limits<T> {};
 
+//   / (gradient, GVF,  PathFinder):
+//   double,  XR_SINGLE_PRECISION - float (   )
+//#define XR_SINGLE_PRECISION
+
 namespace xr
 {
+#ifdef XR_SINGLE_PRECISION
+  typedef float real_t;
+#else
+  typedef double real_t;
+#endif
+
   enum class Orientation {
     Clockwise,
     AntiClockwise
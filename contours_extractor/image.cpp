@@ -5,24 +5,275 @@
 #include <algorithm>
 #include "utility.h"
 #include "xr_math.h"
+#include "image_stats.h"
+#include "convolution.h"
 
 #include <opencv2/opencv.hpp>
 
 namespace xr
 {
+  namespace
+  {
+    /* Скользящий минимум/максимум по окну 2r + 1 (van Herk / Gil-Werman): строка делится
+       на блоки длины 2r + 1, в них считаются префиксные (g) и суффиксные (h) значения,
+       тогда окно [i - r, i + r] = op(h[i - r], g[i + r]) - три операции на точку при любом r.
+       За пределами изображения - значение pad. */
+    template<class Op>
+    void rowExtremum(const uint8_t* src, uint8_t* dst, int width, int height, int r, uint8_t pad, Op op) {
+      const int k = 2 * r + 1;
+      const int n = width + 2 * r;
+      std::vector<uint8_t> f(n, pad), g(n), h(n);
+      for (int y = 0; y < height; ++y) {
+        std::copy(src + y * width, src + (y + 1) * width, f.begin() + r);
+
+        for (int begin = 0; begin < n; begin += k) {
+          const int end = std::min(begin + k, n) - 1;
+          g[begin] = f[begin];
+          for (int t = begin + 1; t <= end; ++t) {
+            g[t] = op(g[t - 1], f[t]);
+          }
+
+          h[end] = f[end];
+          for (int t = end - 1; t >= begin; --t) {
+            h[t] = op(h[t + 1], f[t]);
+          }
+        }
+
+        uint8_t* line = dst + y * width;
+        for (int x = 0; x < width; ++x) {
+          line[x] = op(h[x], g[x + 2 * r]);
+        }
+      }
+    }
+
+    // то же по столбцам; строки обрабатываются целиком, внутренние циклы векторизуются
+    template<class Op>
+    void columnExtremum(const uint8_t* src, uint8_t* dst, int width, int height, int r, uint8_t pad, Op op) {
+      const int k = 2 * r + 1;
+      const int n = height + 2 * r;
+      std::vector<uint8_t> border(width, pad), g(n * width), h(n * width);
+      auto f = [&](int t) {
+        return (t < r || t >= height + r) ? border.data() : src + (t - r) * width;
+      };
+
+      for (int t = 0; t < n; ++t) {
+        const uint8_t* cur = f(t);
+        uint8_t* out = g.data() + t * width;
+        if (t % k == 0) {
+          std::copy(cur, cur + width, out);
+          continue;
+        }
+
+        const uint8_t* prev = out - width;
+        for (int x = 0; x < width; ++x) {
+          out[x] = op(prev[x], cur[x]);
+        }
+      }
+
+      for (int t = n - 1; t >= 0; --t) {
+        const uint8_t* cur = f(t);
+        uint8_t* out = h.data() + t * width;
+        if (t % k == k - 1 || t == n - 1) {
+          std::copy(cur, cur + width, out);
+          continue;
+        }
+
+        const uint8_t* next = out + width;
+        for (int x = 0; x < width; ++x) {
+          out[x] = op(next[x], cur[x]);
+        }
+      }
+
+      for (int y = 0; y < height; ++y) {
+        const uint8_t* lhs = h.data() + y * width;
+        const uint8_t* rhs = g.data() + (y + 2 * r) * width;
+        uint8_t* out = dst + y * width;
+        for (int x = 0; x < width; ++x) {
+          out[x] = op(lhs[x], rhs[x]);
+        }
+      }
+    }
+
+    struct Min {
+      uint8_t operator () (uint8_t a, uint8_t b) const {
+        return a < b ? a : b;
+      }
+    };
+
+    struct Max {
+      uint8_t operator () (uint8_t a, uint8_t b) const {
+        return a < b ? b : a;
+      }
+    };
+
+    // mask -> mask: прямоугольник - два прохода подряд, крест - объединение проходов
+    template<class Op>
+    void morphology(std::vector<uint8_t>& mask, int width, int height, int rx, int ry, Connectivity way, uint8_t pad, Op op) {
+      std::vector<uint8_t> rows(mask.size()), columns(mask.size());
+      rowExtremum(mask.data(), rows.data(), width, height, rx, pad, op);
+      if (way == Four) {
+        columnExtremum(mask.data(), columns.data(), width, height, ry, pad, op);
+        for (size_t i = 0; i < mask.size(); ++i) {
+          mask[i] = op(rows[i], columns[i]);
+        }
+      }
+      else {
+        columnExtremum(rows.data(), mask.data(), width, height, ry, pad, op);
+      }
+    }
+
+    /* Целочисленное ядро 3x3: K(dx, dy) - вес точки (x + dx, y + dy), т.е. kernel(dx + 1, dy + 1)
+       у Matrix-ядер из matrix.h */
+    struct Kernel3x3 {
+      int w[9];
+
+      constexpr int operator () (int dx, int dy) const {
+        return w[(dx + 1) + 3 * (dy + 1)];
+      }
+    };
+
+    constexpr Kernel3x3 sobel_kernel = { { -1, -2, -1, 0, 0, 0, 1, 2, 1 } };
+    constexpr Kernel3x3 sobel_kernel_t = { { -1, 0, 1, -2, 0, 2, -1, 0, 1 } }; // транспонированное
+    constexpr Kernel3x3 laplace4_kernel = { { 0, -1, 0, -1, 5, -1, 0, -1, 0 } };
+    constexpr Kernel3x3 laplace8_kernel = { { 1, 1, 1, 1, -8, 1, 1, 1, 1 } };
+    constexpr Kernel3x3 laplace12_kernel = { { 1, 2, 1, 2, -12, 2, 1, 2, 1 } };
+
+    // отклик ядра в столбце x, l и r - соседние столбцы (на краях - отражённые)
+    template<const Kernel3x3& K>
+    inline int respond(const uint8_t* above, const uint8_t* row, const uint8_t* below, int l, int x, int r) {
+      return K(-1, -1) * above[l] + K(0, -1) * above[x] + K(1, -1) * above[r]
+        + K(-1, 0) * row[l] + K(0, 0) * row[x] + K(1, 0) * row[r]
+        + K(-1, 1) * below[l] + K(0, 1) * below[x] + K(1, 1) * below[r];
+    }
+
+    /* Обход строк окном 3x3, fn(y, above, row, below). За краями - Border::Mirror, как у
+       Convolution: сверху и слева без повтора края (-1 -> 1), снизу и справа с повтором (n -> n - 1) */
+    template<class Fn>
+    void forEachWindowRow(const uint8_t* data, int width, int height, Fn fn) {
+      for (int y = 0; y < height; ++y) {
+        const uint8_t* row = data + (height - y - 1) * width;
+        const uint8_t* above = y > 0 ? row + width : row - width;
+        const uint8_t* below = y < height - 1 ? row - width : row;
+        fn(y, above, row, below);
+      }
+    }
+
+    template<const Kernel3x3& K>
+    void filterRow(const uint8_t* above, const uint8_t* row, const uint8_t* below, int width, int* dst) {
+      dst[0] = respond<K>(above, row, below, 1, 0, 1);
+      for (int x = 1; x < width - 1; ++x) {
+        dst[x] = respond<K>(above, row, below, x - 1, x, x + 1);
+      }
+
+      dst[width - 1] = respond<K>(above, row, below, width - 2, width - 1, width - 1);
+    }
+
+    // отклики в том же порядке, что и пиксели data
+    template<const Kernel3x3& K>
+    std::vector<int> convolve3x3(const uint8_t* data, int width, int height) {
+      std::vector<int> dst(width * height);
+      forEachWindowRow(data, width, height, [&](int, const uint8_t* above, const uint8_t* row, const uint8_t* below) {
+        filterRow<K>(above, row, below, width, dst.data() + (row - data));
+      });
+
+      return dst;
+    }
+
+    /* Компасный оператор Кирша: маска направления ind - вес 5 у трёх соседей подряд (в порядке
+       math::dx/dy, начиная с ind) и -3 у остальных, т.е. 5s - 3(t - s) = 8s - 3t, где t - сумма
+       всех соседей. Тройка следующего направления - сдвиг окна: s(ind + 1) = s(ind) - n[ind] + n[ind + 3].
+       |8s - 3t| <= 6120, поэтому хватает int16. Считается построчно: соседи раскладываются в 8 строк int16,
+       и каждое направление обновляет s и максимум сразу для всей строки */
+    class KirschRow {
+      int count_; // внутренние пиксели строки, x = 1..width - 2
+      std::vector<int16_t> planes_; // 8 строк соседей: W, N, E, S, NW, NE, SE, SW
+      std::vector<int16_t> t3_, s_;
+
+    public:
+      explicit KirschRow(int width) :
+        count_(std::max(width - 2, 0)),
+        planes_(8 * count_),
+        t3_(count_),
+        s_(count_) {
+      }
+
+      // отклики пишутся в dst[1..width - 2], возвращается максимум строки
+      int16_t operator()(const uint8_t* above, const uint8_t* row, const uint8_t* below, int16_t* dst) {
+        const int n = count_;
+        int16_t* f = dst + 1;
+
+        // сосед k пикселя x = i + 1 лежит в src[k][i]
+        const uint8_t* src[8] = { row, above + 1, row + 2, below + 1, above, above + 2, below + 2, below };
+        int16_t* plane[8];
+        for (int k = 0; k < 8; ++k) {
+          plane[k] = planes_.data() + k * n;
+          for (int i = 0; i < n; ++i) {
+            plane[k][i] = src[k][i];
+          }
+        }
+
+        int16_t* t3 = t3_.data();
+        int16_t* s = s_.data();
+        for (int i = 0; i < n; ++i) {
+          const int t = plane[0][i] + plane[1][i] + plane[2][i] + plane[3][i] + plane[4][i] + plane[5][i] + plane[6][i] + plane[7][i];
+          t3[i] = static_cast<int16_t>(3 * t);
+          s[i] = static_cast<int16_t>(plane[0][i] + plane[1][i] + plane[2][i]);
+          f[i] = static_cast<int16_t>(std::abs(8 * s[i] - t3[i]));
+        }
+
+        // направления по одному, каждое - проход по всей строке
+        for (int ind = 1; ind < 8; ++ind) {
+          const int16_t* in = plane[(ind + 2) & 7];
+          const int16_t* out = plane[ind - 1];
+          for (int i = 0; i < n; ++i) {
+            s[i] = static_cast<int16_t>(s[i] + in[i] - out[i]);
+            f[i] = std::max(f[i], static_cast<int16_t>(std::abs(8 * s[i] - t3[i])));
+          }
+        }
+
+        int16_t peak = 0;
+        for (int i = 0; i < n; ++i) {
+          peak = std::max(peak, f[i]);
+        }
+
+        return peak;
+      }
+    };
+
+    // смещение к соседу вдоль оси градиента с кодом math::roundDirCode, второй сосед - симметричный
+    constexpr int axis_dx[4] = { 1, 1, 0, 1 };
+    constexpr int axis_dy[4] = { 0, 1, 1, -1 };
+
+    // [lo, hi] -> [0, 255] ровно так же, как Matrix::scale(0.0, 255.0) и from()
+    std::vector<uint8_t> scaleTable(int lo, int hi) {
+      std::vector<uint8_t> table(hi - lo + 1, 0);
+      if (hi > lo) {
+        const double temp = 255.0 / (hi - lo);
+        for (int v = 0; v <= hi - lo; ++v) {
+          table[v] = static_cast<uint8_t>(v * temp);
+        }
+      }
+
+      return table;
+    }
+  }
+
   /* Image */
   Image::Image(const Image& src):
     data_(new uint8_t[src.width_*src.height_]),
     width_(src.width_),
-    height_(src.height_) {
+    height_(src.height_),
+    capacity_(src.width_*src.height_) {
     memcpy(data_, src.data_, sizeof(uint8_t)*width_*height_);
   }
 
   Image::Image(Image&& src):
     data_(src.data_),
     width_(src.width_),
-    height_(src.height_) {
+    height_(src.height_),
+    capacity_(src.capacity_) {
     src.data_ = nullptr;
+    src.width_ = src.height_ = src.capacity_ = 0;
   }
 
   Image::Image(const cv::Size& size) {
@@ -42,13 +293,7 @@ namespace xr
   Image& Image::operator = (const Image& rhs) {
     if (this == &rhs) return *this;
 
-    if (width_*height_ != rhs.width_*rhs.height_) {
-      release();
-      width_ = rhs.width_;
-      height_ = rhs.height_;
-      data_ = new uint8_t[width_*height_];
-    }
-
+    recreate(rhs.width_, rhs.height_);
     memcpy(data_, rhs.data_, sizeof(uint8_t)*width_*height_);
     return *this;
   }
@@ -60,6 +305,7 @@ namespace xr
     width_ = rhs.width_;
     height_ = rhs.height_;
     std::swap(data_, rhs.data_);
+    std::swap(capacity_, rhs.capacity_);
 
     return *this;
   }
@@ -68,6 +314,7 @@ namespace xr
     std::swap(data_, other.data_);
     std::swap(width_, other.width_);
     std::swap(height_, other.height_);
+    std::swap(capacity_, other.capacity_);
     return *this;
   }
 
@@ -76,9 +323,11 @@ namespace xr
   }
 
   void Image::recreate(int width, int height) {
-    if (width_ * height_ != width * height) {
+    // буфер перевыделяем только если его не хватает
+    if (capacity_ < width * height) {
       release();
       data_ = new uint8_t[width * height];
+      capacity_ = width * height;
     }
 
     width_ = width;
@@ -91,7 +340,7 @@ namespace xr
       data_ = nullptr;
     }
 
-    width_ = height_ = 0;
+    width_ = height_ = capacity_ = 0;
   }
 
   int Image::sum() const {
@@ -131,129 +380,20 @@ namespace xr
   }
 
   uint8_t Image::thresholdByOtsu() const {
-    int pixels = width_*height_;
-    std::vector<double> p = histogram<double>();
-    for (int i = 0; i < 256; ++i) p[i] /= pixels;
-
-    double w1 = 0, n1 = 0, n2 = 0;
-    for (size_t i = 0, n = p.size(); i < n; ++i) {
-      n2 += i*p[i];
-    }
-
-    int threshold = 0;
-    double t_val = 0, sigma, temp;
-
-    for (int i = 0; i < 256; ++i) {
-      w1 += p[i];
-      n1 += i*p[i];
-      n2 -= i*p[i];
-      temp = n1 / w1 - n2 / (1.0 - w1);
-      sigma = w1*(1.0 - w1)*temp*temp;
-
-      if (t_val < sigma) {
-        t_val = sigma;
-        threshold = i;
-      }
-    }
-
-    return static_cast<uint8_t>(threshold);
+    return stats::otsu(stats::histogram(*this));
   }
 
   uint8_t Image::thresholdByBasedGradient() const {
-    double Gx, Gy;
-    double num = 0, denom = 1, temp;
-    for (int i = 1; i < width_ - 1; ++i) {
-      for (int j = 1; j < height_ - 1; ++j) {
-        Gx = abs(byte(i + 1, j) - byte(i - 1, j));
-        Gy = abs(byte(i, j + 1) - byte(i, j - 1));
-        temp = xr::math::max(Gx, Gy);
-        num += byte(i, j)*temp;
-        denom += temp;
-      }
-    }
-
-    return static_cast<uint8_t>(round(num / denom));
+    return stats::gradientThreshold(stats::gradientHistogram(*this));
   }
 
   Matrix<double> Image::convolution(const Matrix<double>& kernel) const {
-    Matrix<double> dst(size(), 0);
-    int r = kernel.width() / 2;
-
-    const int step = 4;
-
-    /* центральная область */
-    double t;
-    int i, j, dx, dy;
-    for (j = r; j < height_ - r - step; j += step) {
-      for (i = r; i < width_ - r; ++i) {
-        for (dy = -r; dy <= r; dy++) {
-          for (dx = -r; dx <= r; dx++) {
-            t = kernel(dx + r, dy + r);
-            dst(i, j) += byte(i + dx, j + dy) * t;
-            dst(i, j + 1) += byte(i + dx, j + 1 + dy) * t;
-            dst(i, j + 2) += byte(i + dx, j + 2 + dy) * t;
-            dst(i, j + 3) += byte(i + dx, j + 3 + dy) * t;
-          }
-        }
-      }
-    }
-
-    /* снизу (+ остаток) */
-    int jj;
-    int tempH = 2 * height_ - 1;
-    int temp = 2 * width_ - 1, temp_ind;
-    while (j < height_) {
-      for (i = 0; i < width_; ++i) {
-        for (dy = -r; dy <= r; dy++) {
-          jj = (j + dy >= height_) ? tempH - j - dy : j + dy;
-          for (dx = -r; dx <= r; dx++) {
-            temp_ind = (i + dx >= width_) ? temp - i - dx : abs(i + dx);
-            dst(i, j) += byte(temp_ind, jj) * kernel(dx + r, dy + r);
-          }
-        }
-      }
-
-      ++j;
-    }
-
-    /* слева */
-    for (j = r; j < height_ - r; ++j) {
-      for (i = 0; i < r; ++i) {
-        for (dy = -r; dy <= r; dy++)
-          for (dx = -r; dx <= r; dx++) {
-            dst(i, j) += byte(abs(i + dx), j + dy)*kernel(dx + r, dy + r);
-          }
-      }
-    }
-
-    /* справа */
-    for (j = r; j < height_ - r; ++j) {
-      for (i = width_ - r; i < width_; ++i) {
-        for (dy = -r; dy <= r; dy++) {
-          for (dx = -r; dx <= r; dx++) {
-            temp_ind = (i + dx >= width_) ? temp - i - dx : i + dx;
-            dst(i, j) += byte(temp_ind, j + dy)*kernel(dx + r, dy + r);
-          }
-        }
-      }
-    }
-
-    /* сверху */
-    for (j = 0; j < r; ++j) {
-      for (i = 0; i < width_; ++i) {
-        for (dy = -r; dy <= r; dy++) {
-          for (dx = -r; dx <= r; dx++) {
-            temp_ind = (i + dx >= width_) ? temp - i - dx : abs(i + dx);
-            dst(i, j) += byte(temp_ind, abs(j + dy))*kernel(dx + r, dy + r);
-          }
-        }
-      }
-    }
-
+    Matrix<double> dst;
+    Convolution(*this, kernel.width() / 2).apply(kernel, dst);
     return dst;
   }
 
-  void Image::gradient(Matrix<double>& u, Matrix<double>& v) const {
+  void Image::gradient(matr& u, matr& v) const {
     u.recreate(width(), height(), 0.0);
     v.recreate(width(), height(), 0.0);
 
@@ -276,104 +416,16 @@ namespace xr
     }
   }
 
-  void Image::gradient(const Matrix<double>& kernel, Matrix<double>& u, Matrix<double>& v) const {
-    u.recreate(width(), height(), 0.0);
-    v.recreate(width(), height(), 0.0);
-
-    Matrix<double> dst(size(), 0.0);
-    int r = kernel.width() / 2;
-
-    // TODO
-
-    /* центральная область */
-    double fx, fy;
-    for (int j = r; j < height_ - r; ++j) {
-      for (int i = r; i < width_ - r; ++i) {
-        fx = fy = 0;
-        for (int dx = -r; dx <= r; dx++) {
-          for (int dy = -r; dy <= r; dy++) {
-            fx += byte(i + dx, j + dy)*kernel(dx + r, dy + r);
-            fy += byte(i + dx, j + dy)*kernel(dy + r, dx + r);
-          }
-        }
-
-        u(i, j) = fx;
-        v(i, j) = fy;
-      }
-    }
-
-    /* слева */
-    for (int j = r; j < height_ - r; ++j) {
-      for (int i = 0; i < r; ++i) {
-        fx = fy = 0;
-        for (int dx = -r; dx <= r; dx++) {
-          for (int dy = -r; dy <= r; dy++) {
-            fx += byte(abs(i + dx), j + dy)*kernel(dx + r, dy + r);
-            fy += byte(abs(i + dx), j + dy)*kernel(dy + r, dx + r);
-          }
-        }
-
-        u(i, j) = fx;
-        v(i, j) = fy;
-      }
-    }
-
-    /* справа */
-    int temp = 2 * width_ - 1, temp_ind;
-    for (int j = r; j < height_ - r; ++j) {
-      for (int i = width_ - r - 1; i < width_; ++i) {
-        fx = fy = 0;
-        for (int dx = -r; dx <= r; dx++) {
-          for (int dy = -r; dy <= r; dy++) {
-            temp_ind = (i + dx >= width_) ? temp - i - dx : i + dx;
-            fx += byte(temp_ind, j + dy)*kernel(dx + r, dy + r);
-            fy += byte(temp_ind, j + dy)*kernel(dy + r, dx + r);
-          }
-        }
-
-        u(i, j) = fx;
-        v(i, j) = fy;
-      }
-    }
-
-    /* сверху */
-    for (int j = 0; j < r; ++j) {
-      for (int i = 0; i < width_; ++i) {
-        fx = fy = 0;
-        for (int dx = -r; dx <= r; dx++) {
-          for (int dy = -r; dy <= r; dy++) {
-            temp_ind = (i + dx >= width_) ? temp - i - dx : abs(i + dx);
-            fx += byte(temp_ind, abs(j + dy))*kernel(dx + r, dy + r);
-            fy += byte(temp_ind, abs(j + dy))*kernel(dy + r, dx + r);
-          }
-        }
-
-        u(i, j) = fx;
-        v(i, j) = fy;
-      }
-    }
-
-    /* снизу */
-    int tempH = 2 * height_ - 1;
-    for (int j = height_ - r; j < height_; ++j) {
-      for (int i = 0; i < width_; ++i) {
-        fx = fy = 0;
-        for (int dx = -r; dx <= r; dx++) {
-          for (int dy = -r; dy <= r; dy++) {
-            temp_ind = (i + dx >= width_) ? temp - i - dx : abs(i + dx);
-            fx += byte(temp_ind, (j + dy >= height_) ? tempH - j - dy : j + dy)*kernel(dx + r, dy + r);
-            fy += byte(temp_ind, (j + dy >= height_) ? tempH - j - dy : j + dy)*kernel(dy + r, dx + r);
-          }
-        }
+  void Image::gradient(const matr& kernel, matr& u, matr& v) const {
+    // u - отклик ядра, v - транспонированного, окно у них общее
+    std::vector<matd> kernels(2, kernel.to<double>());
+    kernels[1].transpose();
 
-        u(i, j) = fx;
-        v(i, j) = fy;
-      }
-    }
+    Convolution(*this, kernel.width() / 2).apply(kernels, std::vector<matr*>{ &u, &v });
   }
 
-  Matrix<double> Image::gradient(std::function<double(double, double)> value_in_point) const {
-    Matrix<double> u, v;
+  matr Image::gradient(std::function<real_t(real_t, real_t)> value_in_point) const {
+    matr u, v;
     gradient(u, v);
 
     // воспользуемся `u` как результирующей матрицей 
@@ -386,8 +438,8 @@ namespace xr
     return u;
   }
 
-  Matrix<double> Image::gradient(const Matrix<double>& kernel, std::function<double(double, double)> value_in_point) const {
-    Matrix<double> u, v;
+  matr Image::gradient(const matr& kernel, std::function<real_t(real_t, real_t)> value_in_point) const {
+    matr u, v;
     gradient(kernel, u, v);
 
     // воспользуемся `u` как результирующей матрицей 
@@ -401,23 +453,25 @@ namespace xr
   }
 
   Image& Image::erode(int radius) {
-    Image old(*this);
+    return erode(radius, radius);
+  }
 
-    bool fl;
-    for (int y = radius, n = height_ - radius; y < n; ++y) {
-      for (int x = radius, m = width_ - radius; x < m; ++x) {
-        if (old.byte(x, y) == 255) {
-          fl = false;
-          for (int i = -radius; i <= radius && !fl; ++i) {
-            for (int j = -radius; j <= radius && !fl; ++j) {
-              if (i == 0 && j == 0) continue;
-              if (old.byte(x + i, y + j) != 255) fl = true;
-            }
-          }
+  Image& Image::erode(int rx, int ry, Connectivity way) {
+    if (width_ <= 2 * rx || height_ <= 2 * ry) return *this;
 
-          if (!fl) byte(x, y) = 255;
-          else byte(x, y) = 0;
-        }
+    std::vector<uint8_t> mask(width_ * height_);
+    for (size_t i = 0; i < mask.size(); ++i) {
+      mask[i] = (data_[i] == 255);
+    }
+
+    morphology(mask, width_, height_, rx, ry, way, 1, Min());
+
+    // окна точек вне поля целиком внутри изображения, поэтому pad не влияет на результат
+    for (int y = ry, n = height_ - ry; y < n; ++y) {
+      uint8_t* line = data_ + y * width_;
+      const uint8_t* eroded = mask.data() + y * width_;
+      for (int x = rx, m = width_ - rx; x < m; ++x) {
+        if (line[x] == 255 && !eroded[x]) line[x] = 0;
       }
     }
 
@@ -425,45 +479,89 @@ namespace xr
   }
 
   Image& Image::dilate(int radius) {
-    Image old(*this);
-    for (int y = radius, n = height_ - radius; y < n; ++y) {
-      for (int x = radius, m = width_ - radius; x < m; ++x) {
-        if (old.byte(x, y) == 255) {
-          for (int i = -radius; i <= radius; ++i) {
-            for (int j = -radius; j <= radius; ++j) {
-              byte(x + i, y + j) = 255;
-            }
-          }
-        }
+    return dilate(radius, radius);
+  }
+
+  Image& Image::dilate(int rx, int ry, Connectivity way) {
+    if (width_ <= 2 * rx || height_ <= 2 * ry) return *this;
+
+    // расширяются только точки вне поля, но их окна могут задевать поле
+    std::vector<uint8_t> mask(width_ * height_, 0);
+    for (int y = ry, n = height_ - ry; y < n; ++y) {
+      const uint8_t* line = data_ + y * width_;
+      uint8_t* cur = mask.data() + y * width_;
+      for (int x = rx, m = width_ - rx; x < m; ++x) {
+        cur[x] = (line[x] == 255);
       }
     }
 
+    morphology(mask, width_, height_, rx, ry, way, 0, Max());
+
+    for (size_t i = 0; i < mask.size(); ++i) {
+      if (mask[i]) data_[i] = 255;
+    }
+
     return *this;
   }
 
   Image& Image::closing(int radius) {
-    dilate(radius);
-    return erode(radius);
+    return closing(radius, radius);
+  }
+
+  Image& Image::closing(int rx, int ry, Connectivity way) {
+    dilate(rx, ry, way);
+    return erode(rx, ry, way);
   }
 
   Image& Image::opening(int radius) {
-    erode(radius);
-    return dilate(radius);
+    return opening(radius, radius);
   }
 
-  Image& Image::nonMaximumSuppression(const matd& directon) {
-    int di, dj;
-    uint8_t current;
+  Image& Image::opening(int rx, int ry, Connectivity way) {
+    erode(rx, ry, way);
+    return dilate(rx, ry, way);
+  }
+
+  Image& Image::nonMaximumSuppression(const Image& direction) {
     Image old(*this);
-    for (int i = 0; i<width_; ++i) {
-      for (int j = 0; j<height_; ++j) {
-        current = old.byte(i, j);
-        di = xr::math::sign((int)round(cos(directon(i, j))));
-        dj = xr::math::sign((int)round(sin(directon(i, j))));
-        if ((isCorrect(i + di, j + dj) && old.byte(i + di, j + dj) > current) ||
-          (isCorrect(i - di, j - dj) && old.byte(i - di, j - dj) > current)) {
-          byte(i, j) = 0;
-        }
+
+    // на краях соседи берутся по таблице смещений с проверкой границ
+    auto suppress = [&](int x, int y) {
+      const int code = direction.byte(x, y);
+      const int dx = axis_dx[code], dy = axis_dy[code];
+      const uint8_t current = old.byte(x, y);
+      if ((isCorrect(x + dx, y + dy) && old.byte(x + dx, y + dy) > current) ||
+        (isCorrect(x - dx, y - dy) && old.byte(x - dx, y - dy) > current)) {
+        byte(x, y) = 0;
+      }
+    };
+
+    for (int x = 0; x < width_; ++x) {
+      suppress(x, 0);
+      if (height_ > 1) suppress(x, height_ - 1);
+    }
+
+    for (int y = 1; y < height_ - 1; ++y) {
+      suppress(0, y);
+      if (width_ > 1) suppress(width_ - 1, y);
+    }
+
+    /* внутри - построчно и без ветвлений: максимум пары соседей по каждой из осей,
+       затем выбор по коду */
+    for (int y = 1; y < height_ - 1; ++y) {
+      const int offset = (height_ - y - 1) * width_;
+      const uint8_t* row = old.data_ + offset;
+      const uint8_t* above = row + width_;
+      const uint8_t* below = row - width_;
+      const uint8_t* code = direction.data_ + offset;
+      uint8_t* dst = data_ + offset;
+      for (int x = 1; x < width_ - 1; ++x) {
+        const uint8_t m0 = std::max(row[x - 1], row[x + 1]);
+        const uint8_t m1 = std::max(above[x - 1], below[x + 1]);
+        const uint8_t m2 = std::max(above[x], below[x]);
+        const uint8_t m3 = std::max(above[x + 1], below[x - 1]);
+        const uint8_t m = code[x] == 0 ? m0 : code[x] == 1 ? m1 : code[x] == 2 ? m2 : m3;
+        dst[x] = m > row[x] ? 0 : row[x];
       }
     }
 
@@ -520,34 +618,50 @@ namespace xr
   }
 
   Image& Image::kuwahara(int radius) {
-    Matrix<double> src(to<double>());
+    const int dx[4] = { -1, 1, -1, 1 };
+    const int dy[4] = { -1, -1, 1, 1 };
+
+    /* суммы яркостей и их квадратов по квадрантам (radius + 1) x (radius + 1) с углом в точке -
+       свёртки с четырьмя ядрами-квадрантами; точки за краем не учитываются */
+    std::vector<matd> quadrants(4, matd(2 * radius + 1, 2 * radius + 1, 0.0));
+    for (int k = 0; k < 4; ++k) {
+      for (int ii = 0; ii <= radius; ++ii) {
+        for (int jj = 0; jj <= radius; ++jj) {
+          quadrants[k](radius + ii * dx[k], radius + jj * dy[k]) = 1.0;
+        }
+      }
+    }
+
+    matd src(width_, height_);
+    for (int y = 0; y < height_; ++y) {
+      const uint8_t* row = data_ + (height_ - y - 1) * width_;
+      double* dst = src.line(y);
+      for (int x = 0; x < width_; ++x) {
+        dst[x] = double(row[x]) * row[x];
+      }
+    }
+
+    std::vector<matd> sums(4), squares(4);
+    Convolution(*this, radius, Border::Zero).apply(quadrants, std::vector<matd*>{ &sums[0], &sums[1], &sums[2], &sums[3] });
+    Convolution(src, radius, Border::Zero).apply(quadrants, std::vector<matd*>{ &squares[0], &squares[1], &squares[2], &squares[3] });
 
-    int n;
     double medium[4];
     double variance[4];
-    int dx[4] = {-1, 1, -1, 1};
-    int dy[4] = {-1, -1, 1, 1};
-
-    for (int i = 1; i < width_ - 1; ++i) {
-      for (int j = 1; j < height_ - 1; ++j) {
+    for (int j = 1; j < height_ - 1; ++j) {
+      uint8_t* cur = row(j);
+      for (int i = 1; i < width_ - 1; ++i) {
         for (int k = 0; k < 4; ++k) {
-          n = 0;
-          variance[k] = medium[k] = 0;
-          for (int ii = 0; abs(ii) <= radius; ii += dx[k]) {
-            for (int jj = 0; abs(jj) <= radius; jj += dy[k]) {
-              if (!isCorrect(i + ii, j + jj)) continue;
-              variance[k] += src(i + ii, j + jj)*src(i + ii, j + jj);
-              medium[k] += src(i + ii, j + jj);
-              ++n;
-            }
-          }
+          // точек квадранта внутри изображения
+          const int nx = std::min(dx[k] < 0 ? i : width_ - 1 - i, radius) + 1;
+          const int ny = std::min(dy[k] < 0 ? j : height_ - 1 - j, radius) + 1;
+          const int n = nx * ny;
 
-          medium[k] /= n;
-          variance[k] = 1.0 / n*variance[k] - medium[k] * medium[k];
+          medium[k] = sums[k](i, j) / n;
+          variance[k] = 1.0 / n*squares[k](i, j) - medium[k] * medium[k];
         }
 
         int target = static_cast<int>(std::min_element(variance, variance + 4) - variance); //ptr. diff
-        byte(i, j) = static_cast<uint8_t>(medium[target]);
+        cur[i] = static_cast<uint8_t>(medium[target]);
       }
     }
 
@@ -555,55 +669,64 @@ namespace xr
   }
 
   Image& Image::laplace(int mode) {
+    std::vector<int> response;
     switch (mode) {
     case 4:
-      *this = convolution(Matrix<double>::makeLaplace4Kernel()).scale(0.0, 255.0);
+      response = convolve3x3<laplace4_kernel>(data_, width_, height_);
       break;
     case 8:
-      *this = convolution(Matrix<double>::makeLaplace8Kernel()).scale(0.0, 255.0);
+      response = convolve3x3<laplace8_kernel>(data_, width_, height_);
       break;
     case 12:
-      *this = convolution(Matrix<double>::makeLaplace12Kernel()).scale(0.0, 255.0);
+      response = convolve3x3<laplace12_kernel>(data_, width_, height_);
       break;
     }
 
+    if (response.empty()) {
+      return *this;
+    }
+
+    auto bounds = std::minmax_element(response.begin(), response.end());
+    const int lo = *bounds.first;
+    auto table = scaleTable(lo, *bounds.second);
+    for (size_t i = 0; i < response.size(); ++i) {
+      data_[i] = table[response[i] - lo];
+    }
+
     return *this;
   }
 
   Image& Image::sobel() {
-    auto abs = [](double fy, double fx) -> double {
-      return std::sqrt(fx*fx + fy*fy);
-    };
+    matr dst(size());
+    std::vector<int> fx(width_), fy(width_);
+    forEachWindowRow(data_, width_, height_, [&](int y, const uint8_t* above, const uint8_t* row, const uint8_t* below) {
+      filterRow<sobel_kernel>(above, row, below, width_, fx.data());
+      filterRow<sobel_kernel_t>(above, row, below, width_, fy.data());
+      for (int x = 0; x < width_; ++x) {
+        dst(x, y) = static_cast<real_t>(std::sqrt(static_cast<double>(fx[x] * fx[x] + fy[x] * fy[x])));
+      }
+    });
 
-    from(gradient(Matrix<double>::makeSobelKernel(), abs).scale(0.0, 255.0));
-    return *this;
+    return from(dst.scale(0.0, 255.0));
   }
 
   Image& Image::kirsch() {
-    Matrix<double> dst(size(), 0.0);
-    for (int i = 1; i < width_ - 1; ++i) {
-      for (int j = 1; j < height_ - 1; ++j) {
-        int f = 0;
-        for (int ind = 0; ind < 8; ++ind) {
-          int s = 0, t = 0;
-          for (int k = 0; k < 3; ++k) {
-            int index = xr::math::normalize(k + ind, 8);
-            s += byte(i + xr::math::dx[index], j + xr::math::dy[index]);
-          }
-
-          for (int k = 3; k < 8; ++k) {
-            int index = xr::math::normalize(k + ind, 8);
-            t += byte(i + xr::math::dx[index], j + xr::math::dy[index]);
-          }
-
-          f = xr::math::max(f, abs(5 * s - 3 * t));
-        }
+    // края остаются нулевыми, поэтому минимум отклика - 0
+    std::vector<int16_t> response(width_ * height_, 0);
+    KirschRow kirsch_row(width_);
+    int16_t peak = 0;
+    for (int y = 1; y < height_ - 1; ++y) {
+      const int offset = (height_ - y - 1) * width_;
+      const uint8_t* row = data_ + offset;
+      peak = std::max(peak, kirsch_row(row + width_, row, row - width_, response.data() + offset));
+    }
 
-        dst(i, j) = f;
-      }
+    auto table = scaleTable(0, peak);
+    for (size_t i = 0; i < response.size(); ++i) {
+      data_[i] = table[response[i]];
     }
 
-    return from(dst.scale(0.0, 255.0));
+    return *this;
   }
 
   Image& Image::clear(const uint8_t& val) {
@@ -616,20 +739,7 @@ namespace xr
   }
 
   Image& Image::histogramEqualize() {
-    std::vector<int> hist = histogram<int>();
-    std::vector<double> table(256);
-
-    int sum = hist[0];
-    table[0] = double(hist[0]);
-    for (int i = 1; i < 256; ++i) {
-      sum += hist[i];
-      table[i] = double(sum);
-    }
-
-    std::vector<uint8_t> LUT(256);
-    for (int i = 0; i < 256; ++i) {
-      LUT[i] = uint8_t(round(255.0*table[i] / sum));
-    }
+    auto LUT = stats::equalization(stats::histogram(*this));
 
     uint8_t* cur = data_;
     for (int i = 0, n = width_*height_; i < n; ++i) {
@@ -641,14 +751,11 @@ namespace xr
   }
 
   Image& Image::contrast() {
-    Matrix<double> kernel(3, 3, 0.0);
-    kernel(1, 1) = 5;
-    kernel(0, 1) = -1;
-    kernel(1, 0) = -1;
-    kernel(2, 1) = -1;
-    kernel(1, 2) = -1;
-
-    from(convolution(kernel));
+    // ядро то же, что у laplace(4), но без нормировки
+    auto response = convolve3x3<laplace4_kernel>(data_, width_, height_);
+    for (size_t i = 0; i < response.size(); ++i) {
+      data_[i] = static_cast<uint8_t>(response[i]);
+    }
 
     return *this;
   }
@@ -858,8 +965,8 @@ namespace xr
     return dst;
   }
 
-  void Image::gvf(double mu, int iters, Matrix<double>& u, Matrix<double>& v) {
-    Matrix<double> f = to<double>();
+  void Image::gvf(double mu, int iters, matr& u, matr& v) {
+    matr f = to<real_t>();
     f.scale(0, 1);
 
     u.recreate(f.width(), f.height(), 0.0);
@@ -884,7 +991,7 @@ namespace xr
     }
 
     /* Compute parameters and initializing arrays */
-    Matrix<double> b(f.size()), c1(f.size()), c2(f.size());
+    matr b(f.size()), c1(f.size()), c2(f.size());
     for (int i = 0; i < width(); ++i) {
       for (int j = 0; j < height(); ++j) {
         b(i, j) = math::sqr(u(i, j)) + math::sqr(v(i, j));
@@ -894,7 +1001,7 @@ namespace xr
     }
 
     /* Solve GVF = (u,v) */
-    Matrix<double> Lu(size()), Lv(size());
+    matr Lu(size()), Lv(size());
     for (int it = 0; it < iters; ++it) {
       /* corners */
       int n = width() - 1;
@@ -909,10 +1016,10 @@ namespace xr
       Lv(0, m) = (2 * v(1, m) + 2 * v(0, m - 1)) - 4 * v(0, m);
 
       /* interior Lu, Lv*/
-      double* uCur, *uPrev, *uNext;
-      double* vCur, *vPrev, *vNext;
-      double* curLu = Lu.data();
-      double* curLv = Lv.data();
+      real_t* uCur, *uPrev, *uNext;
+      real_t* vCur, *vPrev, *vNext;
+      real_t* curLu = Lu.data();
+      real_t* curLv = Lv.data();
       for (int j = 1; j < m; ++j) {
         uCur = u.line(j) + 1;
         uPrev = u.line(j - 1) + 1;
@@ -946,16 +1053,17 @@ namespace xr
       }
 
       /* Update GVF  */
-      double* curU = u.data();
-      double* curV = v.data();
-      double* curb = b.data();
-      double* curC1 = c1.data();
-      double* curC2 = c2.data();
+      const real_t rmu = static_cast<real_t>(mu);
+      real_t* curU = u.data();
+      real_t* curV = v.data();
+      real_t* curb = b.data();
+      real_t* curC1 = c1.data();
+      real_t* curC2 = c2.data();
       curLu = Lu.data();
       curLv = Lv.data();
       for (int i = 0, n = width()*height(); i < n; ++i) {
-        *curU = (1.0 - *curb) * (*curU) + mu * (*curLu++) + *curC1++;
-        *curV = (1.0 - *curb) * (*curV) + mu * (*curLv++) + *curC2++;
+        *curU = (real_t(1) - *curb) * (*curU) + rmu * (*curLu++) + *curC1++;
+        *curV = (real_t(1) - *curb) * (*curV) + rmu * (*curLv++) + *curC2++;
         ++curU;
         ++curV;
         ++curb;
@@ -964,10 +1072,10 @@ namespace xr
   }
 
   Image Image::gvf(double mu, int iters, std::function<double(double, double)> unite_func) {
-    Matrix<double> u(size()), v(size());
+    matr u(size()), v(size());
     gvf(mu, iters, u, v);
 
-    return Matrix<double>::unite(u, v, unite_func);
+    return matr::unite(u, v, unite_func);
   }
 
   /* others */
@@ -10,10 +10,18 @@
 
 namespace xr
 {
+  class Image;
+
+  namespace stats
+  {
+    histogram_t histogram(const Image& image);
+  }
+
   // TODO        (    )
   class Image {
     uint8_t* data_ = nullptr;
     int width_ = 0, height_ = 0;
+    int capacity_ = 0; //     
 
     void recreate(int width, int height);
     void release();
@@ -33,7 +41,8 @@ namespace xr
     Image(const Matrix<T>& src) :
       data_(new uint8_t[src.width()*src.height()]),
       width_(src.width()),
-      height_(src.height()) 
+      height_(src.height()),
+      capacity_(src.width()*src.height())
     {
       for (int i = 0; i<width_; ++i) {
         for (int j = 0; j<height_; ++j) {
@@ -49,16 +58,11 @@ namespace xr
 
     Image clone() const;
 
+    // . stats::histogram
     template<typename T>
     std::vector<T> histogram() const {
-      uint8_t* cur = data_;
-      std::vector<T> dst(256, 0);
-      int pixels = width_*height_;
-      for (int i = 0; i < pixels; ++i) {
-        dst[*cur++] += 1;
-      }
-
-      return dst;
+      auto counts = stats::histogram(*this);
+      return std::vector<T>(counts.begin(), counts.end());
     }
 
     template<typename T>
@@ -90,6 +94,10 @@ namespace xr
       return !data_ || !width_ || !height_;
     }
 
+    int capacity() const {
+      return capacity_;
+    }
+
     uint8_t* data() const {
       return data_;
     }
@@ -152,19 +160,27 @@ namespace xr
     Matrix<double> convolution(const Matrix<double>& kernel) const;
 
     //      
-    void gradient(Matrix<double>& u, Matrix<double>& v) const;
-    void gradient(const Matrix<double>& kernel, Matrix<double>& u, Matrix<double>& v) const;
+    void gradient(matr& u, matr& v) const;
+    void gradient(const matr& kernel, matr& u, matr& v) const;
 
     //  -,    (      )
-    Matrix<double> gradient(std::function<double(double, double)> value_in_point) const;
-    Matrix<double> gradient(const Matrix<double>& kernel, std::function<double(double, double)> value_in_point) const;
+    matr gradient(std::function<real_t(real_t, real_t)> value_in_point) const;
+    matr gradient(const matr& kernel, std::function<real_t(real_t, real_t)> value_in_point) const;
 
+    //   , O(1)     ;
+    //  -  (2 * rx + 1) x (2 * ry + 1)   (way == Four)   rx, ry;
+    // erode     rx, ry  , dilate     
     Image& erode(int radius);
+    Image& erode(int rx, int ry, xr::Connectivity way = xr::Eight);
     Image& dilate(int radius);
+    Image& dilate(int rx, int ry, xr::Connectivity way = xr::Eight);
     Image& closing(int radius);
+    Image& closing(int rx, int ry, xr::Connectivity way = xr::Eight);
     Image& opening(int radius);
+    Image& opening(int rx, int ry, xr::Connectivity way = xr::Eight);
 
-    Image& nonMaximumSuppression(const matd& directon);
+    // direction -   (math::roundDirCode)    
+    Image& nonMaximumSuppression(const Image& direction);
 
     Image& bilateralFiltering(double sigmaS, double sigmaR); 
     Image& gaussianBlur(int radius, double sigma); // TODO        OpenCV
@@ -198,7 +214,7 @@ namespace xr
     Image& fillSmallAreas(size_t max_region_size);
     points_t getPointsRegion(int x, int y, xr::Connectivity way = xr::Four, int upper_limit = Int::max()) const;
 
-    void gvf(double mu, int iters, Matrix<double>& u, Matrix<double>& v);
+    void gvf(double mu, int iters, matr& u, matr& v);
 
     Image gvf(double mu, int iters, std::function<double(double, double)> unite_func);
   };
@@ -0,0 +1,171 @@
+﻿#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include "image_stats.h"
+
+namespace xr
+{
+  namespace stats
+  {
+    namespace
+    {
+      const int lanes = 4;
+
+      class Accumulator {
+        uint32_t counts_[lanes][256] = {};
+        int lane_ = 0;
+
+      public:
+        void add(const uint8_t* cur, int n) {
+          int i = 0;
+          for (; i + lanes <= n; i += lanes) {
+            ++counts_[0][cur[i]];
+            ++counts_[1][cur[i + 1]];
+            ++counts_[2][cur[i + 2]];
+            ++counts_[3][cur[i + 3]];
+          }
+
+          for (; i < n; ++i) {
+            add(cur[i]);
+          }
+        }
+
+        void add(uint8_t value) {
+          ++counts_[lane_][value];
+          lane_ = (lane_ + 1) % lanes;
+        }
+
+        histogram_t result() const {
+          histogram_t dst(256, 0);
+          for (int v = 0; v < 256; ++v) {
+            dst[v] = static_cast<int>(counts_[0][v] + counts_[1][v] + counts_[2][v] + counts_[3][v]);
+          }
+
+          return dst;
+        }
+      };
+
+      const uint8_t* row(const Image& image, int y) {
+        return image.data() + (image.height() - y - 1) * image.width();
+      }
+    }
+
+    histogram_t histogram(const Image& image) {
+      Accumulator acc;
+      acc.add(image.data(), image.width() * image.height());
+      return acc.result();
+    }
+
+    histogram_t histogram(const Image& image, const rect_t& roi) {
+      Accumulator acc;
+      for (int y = roi.bottom; y <= roi.top; ++y) {
+        acc.add(row(image, y) + roi.left, roi.right - roi.left + 1);
+      }
+
+      return acc.result();
+    }
+
+    histogram_t histogram(const Image& image, const BinaryImage& mask) {
+      using word_t = BinaryImage::word_t;
+      const int bits = BinaryImage::word_bits;
+
+      Accumulator acc;
+      for (int y = 0; y < image.height(); ++y) {
+        const uint8_t* pixels = row(image, y);
+        const word_t* words = mask.line(y);
+        for (int x = 0; x < image.width(); x += bits) {
+          word_t word = words[x / bits];
+          int n = std::min(bits, image.width() - x);
+          if (word == ~word_t(0) && n == bits) {
+            acc.add(pixels + x, bits);
+            continue;
+          }
+
+          for (int b = 0; word; ++b, word >>= 1) {
+            if (word & 1) acc.add(pixels[x + b]);
+          }
+        }
+      }
+
+      return acc.result();
+    }
+
+    std::vector<int64_t> gradientHistogram(const Image& image) {
+      std::vector<int64_t> weights(256, 0);
+      for (int y = 1; y < image.height() - 1; ++y) {
+        const uint8_t* up = row(image, y - 1);
+        const uint8_t* cur = row(image, y);
+        const uint8_t* down = row(image, y + 1);
+        for (int x = 1; x < image.width() - 1; ++x) {
+          int gx = std::abs(cur[x + 1] - cur[x - 1]);
+          int gy = std::abs(down[x] - up[x]);
+          weights[cur[x]] += std::max(gx, gy);
+        }
+      }
+
+      return weights;
+    }
+
+    uint8_t otsu(const histogram_t& hist) {
+      int pixels = 0;
+      for (auto count : hist) {
+        pixels += count;
+      }
+
+      std::vector<double> p(hist.begin(), hist.end());
+      for (int i = 0; i < 256; ++i) p[i] /= pixels;
+
+      double w1 = 0, n1 = 0, n2 = 0;
+      for (size_t i = 0, n = p.size(); i < n; ++i) {
+        n2 += i*p[i];
+      }
+
+      int threshold = 0;
+      double t_val = 0, sigma, temp;
+
+      for (int i = 0; i < 256; ++i) {
+        w1 += p[i];
+        n1 += i*p[i];
+        n2 -= i*p[i];
+        temp = n1 / w1 - n2 / (1.0 - w1);
+        sigma = w1*(1.0 - w1)*temp*temp;
+
+        if (t_val < sigma) {
+          t_val = sigma;
+          threshold = i;
+        }
+      }
+
+      return static_cast<uint8_t>(threshold);
+    }
+
+    uint8_t gradientThreshold(const std::vector<int64_t>& weights) {
+      // суммы целые, поэтому результат тот же, что при накоплении в double по точкам
+      int64_t num = 0, denom = 1;
+      for (int v = 0; v < 256; ++v) {
+        num += v * weights[v];
+        denom += weights[v];
+      }
+
+      return static_cast<uint8_t>(round(double(num) / double(denom)));
+    }
+
+    std::vector<uint8_t> equalization(const histogram_t& hist) {
+      std::vector<double> table(256);
+
+      int sum = hist[0];
+      table[0] = double(hist[0]);
+      for (int i = 1; i < 256; ++i) {
+        sum += hist[i];
+        table[i] = double(sum);
+      }
+
+      std::vector<uint8_t> lut(256);
+      for (int i = 0; i < 256; ++i) {
+        lut[i] = uint8_t(round(255.0*table[i] / sum));
+      }
+
+      return lut;
+    }
+  }
+}
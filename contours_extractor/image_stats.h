@@ -0,0 +1,30 @@
+﻿#pragma once
+#include "defs.h"
+#include "rect.h"
+#include "image.h"
+#include "binary_image.h"
+
+namespace xr
+{
+  // Гистограммы яркости и пороги по ним: изображение обходится один раз,
+  // Отсу, порог по градиенту и таблица выравнивания считаются уже по гистограмме
+  namespace stats
+  {
+    // 256 корзин; точки раскладываются по нескольким подгистограммам по очереди, поэтому
+    // соседние инкременты одной корзины не ждут друг друга; roi - границы включительно
+    histogram_t histogram(const Image& image);
+    histogram_t histogram(const Image& image, const rect_t& roi);
+    histogram_t histogram(const Image& image, const BinaryImage& mask);
+
+    // суммарный вес max(|Gx|, |Gy|) (центральные разности) точек каждой яркости, без рамки шириной 1
+    std::vector<int64_t> gradientHistogram(const Image& image);
+
+    uint8_t otsu(const histogram_t& hist);
+
+    // среднее яркости с весом градиента: sum(v * w[v]) / (1 + sum(w[v]))
+    uint8_t gradientThreshold(const std::vector<int64_t>& weights);
+
+    // таблица выравнивания гистограммы
+    std::vector<uint8_t> equalization(const histogram_t& hist);
+  }
+}
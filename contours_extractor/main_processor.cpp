@@ -9,19 +9,22 @@
 #include "multithreaded_threshold_finder.h"
 #include "dev_contours_finder.h"
 #include "simple_contours_finder.h"
+#include "border_contours_finder.h"
 
 namespace xr
 {
   MainProcessor::MainProcessor(int flags) :
     grad_op_type_(GradientOpType::Kirsch),
-    flags_(flags)
+    flags_(flags),
+    data_(std::make_shared<Data>())
   {
 
   }
 
   MainProcessor::MainProcessor(Image&& image, int flags):
     grad_op_type_(GradientOpType::Kirsch),
-    flags_(flags)
+    flags_(flags),
+    data_(std::make_shared<Data>())
   {
     assign(std::move(image));
   }
@@ -31,7 +34,7 @@ namespace xr
   }
 
   void MainProcessor::assign(Image&& image) {
-    data_.reset(new Data(std::move(image)));
+    data_->assign(std::move(image));
 
     // тут будет размытие
     if (flags_ & UseAutoBlur) {
@@ -42,21 +45,30 @@ namespace xr
     data_->prepare();
   }
 
+  void MainProcessor::setFlags(int flags) {
+    if ((flags ^ flags_) & UseOpenMP) {
+      threshold_finder_.reset();
+    }
+
+    flags_ = flags;
+  }
+
   void MainProcessor::setGradientOpType(GradientOpType type) {
     grad_op_type_ = type;
   }
 
   void MainProcessor::setContoursFinderType(FinderType type) {
+    if (type != cont_finder_type_) {
+      contours_finder_.reset();
+    }
+
     cont_finder_type_ = type;
   }
 
   void MainProcessor::prepare(uint8_t* threshold) {
-    Matrix<double> u, v;
+    matr u, v;
     data_->working.gvf(0.0333, 70, u, v); // TODO поменьше итераций
 
-    auto temp(std::move(matd::unite(u, v, math::grad::abs)));
-    auto directon(std::move(matd::unite(v, u, math::grad::dirInDeg).transform(math::roundDir)));
-
     switch (grad_op_type_) {
     case GradientOpType::Sobel: data_->working.sobel(); break;
     case GradientOpType::Kirsch: data_->working.kirsch(); break;
@@ -64,18 +76,25 @@ namespace xr
       assert(false);
     }
 
-    for (int i = 0; i < temp.width(); ++i) {
-      for (int j = 0; j < temp.height(); ++j) {
-        temp(i, j) *= data_->working.byte(i, j);
+    /* за один проход: ось направления GVF для подавления немаксимумов и энергия границы
+       (модуль GVF * оператор); воспользуемся `u` как результирующей матрицей */
+    Image direction(u.width(), u.height());
+    for (int j = 0; j < u.height(); ++j) {
+      for (int i = 0; i < u.width(); ++i) {
+        const real_t angle = static_cast<real_t>(math::grad::dirInDeg(v(i, j), u(i, j)));
+        direction.byte(i, j) = static_cast<uint8_t>(math::roundDirCode(angle));
+
+        const real_t magnitude = static_cast<real_t>(math::grad::abs(u(i, j), v(i, j)));
+        u(i, j) = magnitude * data_->working.byte(i, j);
       }
     }
 
-    data_->working.from(temp.scaled(0.0, 255.0));
+    data_->working.from(u.scale(0.0, 255.0));
     if (threshold) {
       *threshold = data_->working.thresholdByBasedGradient();
     }
 
-    data_->working.nonMaximumSuppression(directon);
+    data_->working.nonMaximumSuppression(direction);
   }
   
   void MainProcessor::accurateSplit(contour_t& first, contour_t& second) {
@@ -155,41 +174,59 @@ namespace xr
     uint8_t threshold;
     prepare(&threshold);
 
-    ThresholdFinder::HardPtr threshold_finder;
-    if (flags_ & UseOpenMP) {
-      threshold_finder = std::make_shared<MultithreadedThresholdFinder>(data_);
+    if (!threshold_finder_) {
+      if (flags_ & UseOpenMP) {
+        threshold_finder_ = std::make_shared<MultithreadedThresholdFinder>(data_);
+      }
+      else {
+        threshold_finder_ = std::make_shared<ThresholdFinder>(data_);
+      }
     }
     else {
-      threshold_finder = std::make_shared<ThresholdFinder>(data_);
+      threshold_finder_->reset();
     }
 
-    auto target_threshold = threshold_finder->find(threshold, 0.05, 10);
+    auto target_threshold = threshold_finder_->find(threshold, 0.05, 10);
 
-    auto item = threshold_finder->goodImage();
-    data_->working = std::move(*item.image);
+    // обмен, а не перемещение: буфер working вернется в пул кандидатов
+    auto& item = threshold_finder_->goodImage();
+    data_->working.swap(*item.image);
 
     contours_t contours;
-    ContoursFinder::HardPtr finder;
-    if (cont_finder_type_ == FinderType::Radial) {
-      finder = std::make_shared<DevContoursFinder>(data_);
+    if (!contours_finder_) {
+      if (cont_finder_type_ == FinderType::Radial) {
+        contours_finder_ = std::make_shared<DevContoursFinder>(data_);
+      }
+      else if (cont_finder_type_ == FinderType::Border) {
+        contours_finder_ = std::make_shared<BorderContoursFinder>(data_);
+      }
+      else {
+        contours_finder_ = std::make_shared<SimpleContoursFinder>(data_);
+      }
     }
     else {
-      finder = std::make_shared<SimpleContoursFinder>(data_);
+      contours_finder_->reset();
     }
     
     // ищем начальные контуры
     uint8_t otsu = data_->otsu_threshold;
     auto mode = ContoursFinder::SearchMode::FilterOut;
-    contours = finder->find(&data_->working, mode, otsu);
+    contours = contours_finder_->find(&data_->working, mode, otsu);
 
     // далее - уточнение
     if (flags_ & UseActiveContours) {
-      matd u, v;
-      data_->working.gvf(0.05, 32, u, v);
-      auto gvf_field = std::move(matd::unite(u, v, math::grad::abs).scaled(0, 1.0));
+      data_->working.gvf(0.05, 32, gvf_u_, gvf_v_);
+      matr::unite(gvf_u_, gvf_v_, math::grad::abs, gvf_field_).scale(0, 1.0);
+
+      if (!active_contours_) {
+        active_contours_ = std::make_shared<ActiveContours>(data_);
+      }
+      else {
+        active_contours_->reset();
+      }
 
-      ActiveContours active_contours(data_);
-      active_contours.setGradientRef(&gvf_field);
+      auto& active_contours = *active_contours_;
+      active_contours.setGradientRef(&gvf_field_);
       active_contours.setSimplificationDegree(5);
       //active_contours.enableUniformPointsDistribution(true);
 
@@ -1,5 +1,7 @@
 #pragma once
 #include "session.h"
+#include "active_contours.h"
+#include "threshold_finder.h"
 
 namespace xr
 {
@@ -8,7 +10,8 @@ namespace xr
     enum class FinderType {
       Rosenfeld,
       Radial,
-      Simple
+      Simple,
+      Border
     };
 
     enum class GradientOpType {
@@ -29,6 +32,12 @@ namespace xr
     GradientOpType grad_op_type_ = GradientOpType::Kirsch;
     Data::HardPtr data_;
 
+    // создаются при первом использовании и переиспользуются для следующих изображений
+    ThresholdFinder::HardPtr threshold_finder_;
+    ContoursFinder::HardPtr contours_finder_;
+    std::shared_ptr<ActiveContours> active_contours_;
+    matr gvf_u_, gvf_v_, gvf_field_;
+
     void prepare(uint8_t* threshold = nullptr);
     void accurateSplit(contour_t& first, contour_t& second);
 
@@ -38,7 +47,9 @@ namespace xr
 
     Data::HardPtr data();
 
+    // буферы предыдущего изображения переиспользуются, если их хватает
     void assign(Image&& image);
+    void setFlags(int flags);
     void setGradientOpType(GradientOpType type);
     void setContoursFinderType(FinderType type);
 
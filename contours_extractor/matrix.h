@@ -9,6 +9,7 @@ namespace xr
   {
     T* data_ = nullptr;
     int width_ = 0, height_ = 0;
+    int capacity_ = 0; //     
 
     void release() {
       if (data_) {
@@ -16,7 +17,7 @@ namespace xr
         data_ = nullptr;
       }
 
-      width_ = height_ = 0;
+      width_ = height_ = capacity_ = 0;
     }
 
   public:
@@ -25,7 +26,8 @@ namespace xr
     Matrix(const Matrix<T>& other) :
       data_(new T[other.width_*other.height_]),
       width_(other.width_),
-      height_(other.height_)
+      height_(other.height_),
+      capacity_(other.width_*other.height_)
     {
       memcpy(data_, other.data_, sizeof(T)*width_*height_);
     }
@@ -33,9 +35,11 @@ namespace xr
     Matrix(Matrix<T>&& other) :
       data_(other.data_),
       width_(other.width_),
-      height_(other.height_) 
+      height_(other.height_),
+      capacity_(other.capacity_)
     {
       other.data_ = nullptr;
+      other.width_ = other.height_ = other.capacity_ = 0;
     }
 
     Matrix(const cv::Size& size, const T& val = 0) {
@@ -55,13 +59,7 @@ namespace xr
     Matrix<T>& operator = (const Matrix<T>& rhs) {
       if (this == &rhs) return *this;
 
-      if (width_*height_ != rhs.width_*rhs.height_) {
-        release();
-        width_ = rhs.width_;
-        height_ = rhs.height_;
-        data_ = new T[width_*height_];
-      }
-
+      recreate(rhs.width_, rhs.height_);
       memcpy(data_, rhs.data_, sizeof(T)*width_*height_);
       return *this;
     }
@@ -73,12 +71,20 @@ namespace xr
       width_ = rhs.width_;
       height_ = rhs.height_;
       std::swap(data_, rhs.data_);
+      std::swap(capacity_, rhs.capacity_);
 
       return *this;
     }
    
     static Matrix<T> unite(const Matrix<T>& lhs, const Matrix<T>& rhs, std::function<T(T, T)> unite_func) {
-      Matrix<T> dst(lhs.size());
+      Matrix<T> dst;
+      unite(lhs, rhs, unite_func, dst);
+      return dst;
+    }
+
+    //  ,        (  )
+    static Matrix<T>& unite(const Matrix<T>& lhs, const Matrix<T>& rhs, std::function<T(T, T)> unite_func, Matrix<T>& dst) {
+      dst.recreate(lhs.width(), lhs.height());
       for (int i = 0; i < lhs.width(); ++i) {
         for (int j = 0; j < lhs.height(); ++j) {
           dst(i, j) = unite_func(lhs(i, j), rhs(i, j));
@@ -90,12 +96,7 @@ namespace xr
 
     template<typename S>
     Matrix<T>& from(const Matrix<S>& src) {
-      if (data_) delete[] data_;
-
-      data_ = new T[src.width() * src.height()];
-      width_ = src.width();
-      height_ = src.height();
-
+      recreate(src.width(), src.height());
       for (int i = 0; i < width_; ++i) {
         for (int j = 0; j < height_; ++j) {
           at(i, j) = static_cast<T>(src(i, j));
@@ -122,10 +123,12 @@ namespace xr
       clear(val);
     }
 
+    //        
     void recreate(int width, int height) {
-      if (width_ * height_ != width * height) {
+      if (capacity_ < width * height) {
         release();
         data_ = new T[width * height];
+        capacity_ = width * height;
       }
 
       width_ = width;
@@ -136,6 +139,7 @@ namespace xr
       std::swap(data_, matrix.data_);
       std::swap(width_, matrix.width_);
       std::swap(height_, matrix.height_);
+      std::swap(capacity_, matrix.capacity_);
     }
 
     T* data() const {
@@ -146,6 +150,10 @@ namespace xr
       return !data_;
     }
 
+    int capacity() const {
+      return capacity_;
+    }
+
     cv::Size size() const {
       return cv::Size(width_, height_);
     }
@@ -285,6 +293,7 @@ namespace xr
 
       delete[] data_;
       data_ = dst;
+      capacity_ = height_*width_;
 
       std::swap(height_, width_);
       return *this;
@@ -380,6 +389,7 @@ namespace xr
   };
 
   using matd = Matrix<double>;
+  using matr = Matrix<real_t>;
   using matb = Matrix<bool>;
   using mati = Matrix<int>;
 }
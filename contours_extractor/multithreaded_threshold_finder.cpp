@@ -18,6 +18,13 @@ namespace xr
 
   }
 
+  void MultithreadedThresholdFinder::reset() {
+    ThresholdFinder::reset();
+    for (auto& finder : finders_) {
+      finder->reset();
+    }
+  }
+
   uint8_t MultithreadedThresholdFinder::find(uint8_t approximation, double step, int count) {
     target_index_ = -1;
     buffer_.clear();
@@ -29,11 +36,14 @@ namespace xr
     for (int ind = 1; ind<count; ++ind) {
       auto current_threshold = static_cast<uint8_t>(approximation*ind*step);
       if (targets.empty() || current_threshold != std::get<2>(targets.back())) {
-        ContoursFinder::HardPtr contours_finder = std::make_shared<DevContoursFinder>(data_);
+        int index = static_cast<int>(targets.size());
+        if (static_cast<int>(finders_.size()) <= index) {
+          finders_.push_back(std::make_shared<DevContoursFinder>(data_));
+        }
 
-        auto clone = std::make_shared<Image>(std::move(data_->working.clone()));
+        auto clone = candidate(index);
         auto verifier = std::make_shared<Verifier>(data_, binary_ver_);
-        verifier->setContoursFinder(contours_finder);
+        verifier->setContoursFinder(finders_[index]);
 
         targets.push_back(std::make_tuple(verifier, clone, current_threshold));
       }
@@ -4,9 +4,12 @@
 namespace xr
 {
   class MultithreadedThresholdFinder : public ThresholdFinder {
+    std::vector<ContoursFinder::HardPtr> finders_; // по одному на каждый порог
+
   public:
     MultithreadedThresholdFinder(Data::HardPtr data);
 
+    void reset() override;
     uint8_t find(uint8_t approximation, double step, int count) override;
   };
 }
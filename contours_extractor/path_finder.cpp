@@ -19,6 +19,13 @@ namespace xr
 
   }
 
+  void PathFinder::resize(const cv::Size& size) {
+    price_.recreate(size.width, size.height, 0);
+    aux_price_.recreate(size.width, size.height, 0);
+    label_map_.recreate(size.width, size.height, 0);
+    label_ = 0;
+  }
+
   bool PathFinder::find(point_t first, point_t last, int flag, bool include_init_points) {
     assert(pass_map_ != nullptr);
 
@@ -88,12 +95,12 @@ namespace xr
     return last_path_;
   }
 
-  void PathFinder::setGradientRef(Matrix<double>* gradient) {
+  void PathFinder::setGradientRef(matr* gradient) {
     grad_ref_ = gradient;
     medium_ = grad_ref_->medium();
   }
 
-  void PathFinder::setGradient(const Matrix<double>& gradient) {
+  void PathFinder::setGradient(const matr& gradient) {
     grad_ = gradient;
     setGradientRef(&grad_);
   }
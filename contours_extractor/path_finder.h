@@ -37,10 +37,10 @@ namespace xr
     double factor_ = 0.0;
     double medium_ = 0.0;
     path_t last_path_;
-    Matrix<double> grad_;
+    matr grad_;
     Matrix<int> label_map_;
-    Matrix<double>* grad_ref_ = nullptr;
-    Matrix<double> price_, aux_price_;
+    matr* grad_ref_ = nullptr;
+    matr price_, aux_price_;
     PassabilityMap::HardPtr pass_map_;
 
   public:
@@ -55,11 +55,14 @@ namespace xr
     PathFinder();
     PathFinder(const cv::Size& size);
 
+    // подгоняет размеры внутренних карт (память перевыделяется только при росте)
+    void resize(const cv::Size& size);
+
     bool find(point_t first, point_t last, int flag = Distance | Gradient, bool include_init_points = false);
     path_t lastPath() const;
 
-    void setGradientRef(Matrix<double>* gradient);
-    void setGradient(const Matrix<double>& gradient);
+    void setGradientRef(matr* gradient);
+    void setGradient(const matr& gradient);
     void setPassability(PassabilityMap::HardPtr map);
     void scaleGradient(double down, double up);
     void setFactor(double factor);
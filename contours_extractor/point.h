@@ -129,7 +129,7 @@ namespace xr
 
   template<class T>
   double sqrDist(const point<T>& p1, const point<T>& p2) {
-    return math::sqr(p1.x - p2.x) + math::sqr(p1.x - p2.y);
+    return math::sqr(p1.x - p2.x) + math::sqr(p1.y - p2.y);
   }
 
   template<class T>
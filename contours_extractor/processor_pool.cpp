@@ -0,0 +1,51 @@
+﻿#include <thread>
+#include <algorithm>
+#include "processor_pool.h"
+
+namespace xr
+{
+  ProcessorPool::ProcessorPool(int flags, size_t max_size) :
+    flags_(flags),
+    max_size_(max_size)
+  {
+    if (!max_size_) {
+      max_size_ = std::max<size_t>(1, std::thread::hardware_concurrency());
+    }
+  }
+
+  ProcessorPool::Processor ProcessorPool::acquire() {
+    std::unique_ptr<MainProcessor> processor;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      released_.wait(lock, [this] { return !idle_.empty() || created_ < max_size_; });
+
+      if (!idle_.empty()) {
+        processor = std::move(idle_.back());
+        idle_.pop_back();
+      }
+      else {
+        ++created_;
+      }
+    }
+
+    // новый обработчик создаем вне блокировки
+    if (!processor) {
+      processor.reset(new MainProcessor(flags_));
+    }
+
+    return Processor(processor.release(), [this](MainProcessor* ptr) { release(ptr); });
+  }
+
+  void ProcessorPool::release(MainProcessor* processor) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      idle_.emplace_back(processor);
+    }
+
+    released_.notify_one();
+  }
+
+  size_t ProcessorPool::maxSize() const {
+    return max_size_;
+  }
+}
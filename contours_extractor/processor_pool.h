@@ -0,0 +1,40 @@
+﻿#pragma once
+#include <mutex>
+#include <vector>
+#include <memory>
+#include <condition_variable>
+#include "main_processor.h"
+
+namespace xr
+{
+  // потокобезопасный пул долгоживущих MainProcessor'ов:
+  // буферы обработчиков переиспользуются от изображения к изображению
+  class ProcessorPool {
+  public:
+    using HardPtr = std::shared_ptr<ProcessorPool>;
+    using Processor = std::shared_ptr<MainProcessor>;
+
+  private:
+    int flags_;
+    size_t max_size_;
+    size_t created_ = 0;
+    std::vector<std::unique_ptr<MainProcessor>> idle_;
+    std::mutex mutex_;
+    std::condition_variable released_;
+
+    void release(MainProcessor* processor);
+
+  public:
+    // max_size = 0 - по числу аппаратных потоков
+    ProcessorPool(int flags, size_t max_size = 0);
+
+    ProcessorPool(const ProcessorPool&) = delete;
+    ProcessorPool& operator = (const ProcessorPool&) = delete;
+
+    // ждет свободный обработчик; при уничтожении указателя он вернется в пул
+    // (пул должен пережить все выданные обработчики)
+    Processor acquire();
+
+    size_t maxSize() const;
+  };
+}
@@ -2,17 +2,19 @@
 
 namespace xr
 {
-  Data::Data(Image&& source) :
-    initial(source) 
-  {
+  Data::Data(Image&& source) {
+    assign(std::move(source));
+  }
+
+  void Data::assign(Image&& source) {
+    initial.swap(source);
     otsu_threshold = initial.thresholdByOtsu();
-    working = std::move(initial.clone());
+    working = initial;
   }
 
   void Data::prepare() {
-    Matrix<double> u, v;
-    working.gradient(Matrix<double>::makeSobelKernel(), u, v);
-    gradient = std::move(Matrix<double>::unite(u, v, math::grad::abs));
-    gradient_dir = std::move(Matrix<double>::unite(u, v, math::grad::dirInRad));
+    working.gradient(matr::makeSobelKernel(), u_, v_);
+    matr::unite(u_, v_, math::grad::abs, gradient);
+    matr::unite(u_, v_, math::grad::dirInRad, gradient_dir);
   }
 }
@@ -11,12 +11,18 @@ namespace xr
 
     Image initial;
     Image working; //     
-    Matrix<double> gradient;
-    Matrix<double> gradient_dir;
-    uint8_t otsu_threshold; //      
+    matr gradient;
+    matr gradient_dir;
+    uint8_t otsu_threshold = 0; //      
 
+    Data() = default;
     Data(Image&& source);
 
+    //    ,   
+    void assign(Image&& source);
     void prepare();
+
+  private:
+    matr u_, v_; //   (  prepare)
   };
 }
@@ -9,10 +9,7 @@ namespace xr
 {
   SimpleContoursFinder::SimpleContoursFinder(Data::HardPtr data) :
     ContoursFinder(data) {
-    path_finder_ = std::make_shared<PathFinder>(data_->initial.size());
-    path_finder_->setGradientRef(&data_->gradient);
-    path_finder_->scaleGradient(0.0, 255.0);
-    path_finder_->setFactor(0.0);
+    reset();
   }
 
   contours_t SimpleContoursFinder::find(Image* image, SearchMode mode, int threshold) {
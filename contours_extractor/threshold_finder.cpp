@@ -15,8 +15,10 @@ namespace xr
   void ThresholdFinder::Verifier::removalDiscontinuities() {
     GapsRemover remover(data_, working_copy_);
 
+    // на этом этапе изображение бинарное - замыкание делается над словами по 64 точки
     working_copy_->setFrame(1, 255);
-    working_copy_->closing(1);
+    bits_.assign(*working_copy_).closing(1);
+    bits_.to(*working_copy_);
 
     int size = 1;
     double factors[] = {1.5, 1.25, 1.5, 1.0, 1.75, 1.75};
@@ -48,7 +50,7 @@ namespace xr
     working_copy_->fillSmallAreas(16 * 16);
   }
 
-  ThresholdFinder::Verifier::Verifier(Data::HardPtr data, std::shared_ptr<Image> binary):
+  ThresholdFinder::Verifier::Verifier(Data::HardPtr data, std::shared_ptr<BinaryImage> binary):
     data_(data),
     binary_ver_(binary)
   {
@@ -71,7 +73,7 @@ namespace xr
 
     regions_t regions;
     uint8_t otsu = data_->otsu_threshold;
-    mati marked = colorize(*working_copy_, data_->initial, &regions);
+    mati marked = colorize(*working_copy_, data_->initial, &regions, binary_ver_.get());
 
     auto mode = ContoursFinder::SearchMode::All;
     dst.contours = contours_finder_->find(working_copy_, mode, otsu);
@@ -90,8 +92,28 @@ namespace xr
   ThresholdFinder::ThresholdFinder(Data::HardPtr data):
     data_(data)
   {
-    binary_ver_.reset(new Image(std::move(data_->initial.clone())));
-    binary_ver_->binarization(data_->otsu_threshold);
+    reset();
+  }
+
+  void ThresholdFinder::reset() {
+    if (!binary_ver_) {
+      binary_ver_ = std::make_shared<BinaryImage>();
+    }
+    binary_ver_->assign(data_->initial, data_->otsu_threshold);
+
+    if (contours_finder_) {
+      contours_finder_->reset();
+    }
+  }
+
+  std::shared_ptr<Image> ThresholdFinder::candidate(int index) {
+    while (static_cast<int>(candidates_.size()) <= index) {
+      candidates_.push_back(std::make_shared<Image>());
+    }
+
+    // копирование в уже выделенный буфер
+    *candidates_[index] = data_->working;
+    return candidates_[index];
   }
 
   uint8_t ThresholdFinder::find(uint8_t approximation, double step, int count) {
@@ -101,16 +123,18 @@ namespace xr
     using target_t = std::tuple<Verifier::HardPtr, std::shared_ptr<Image>, uint8_t>;
 
     // TODO SimpleContoursFinder -> DevContoursFinder
-    ContoursFinder::HardPtr contours_finder = std::make_shared<DevContoursFinder>(data_);
+    if (!contours_finder_) {
+      contours_finder_ = std::make_shared<DevContoursFinder>(data_);
+    }
 
     // просчитаем пороги
     std::vector<target_t> targets;
     for (int ind = 1; ind<count; ++ind) {
       auto current_threshold = static_cast<uint8_t>(approximation*ind*step);
       if (targets.empty() || current_threshold != std::get<2>(targets.back())) {
-        auto clone = std::make_shared<Image>(std::move(data_->working.clone()));
+        auto clone = candidate(static_cast<int>(targets.size()));
         auto verifier = std::make_shared<Verifier>(data_, binary_ver_);
-        verifier->setContoursFinder(contours_finder);
+        verifier->setContoursFinder(contours_finder_);
 
         targets.push_back(std::make_tuple(verifier, std::move(clone), current_threshold));
       }
@@ -3,6 +3,7 @@
 #include "session.h"
 #include "contours_finder.h"
 #include "image.h"
+#include "binary_image.h"
 
 namespace xr
 {
@@ -24,13 +25,14 @@ namespace xr
     protected:
       Data::HardPtr data_;
       Image* working_copy_;
-      std::shared_ptr<Image> binary_ver_;
+      std::shared_ptr<BinaryImage> binary_ver_;
+      BinaryImage bits_; // кандидат в битах для морфологии
       ContoursFinder::HardPtr contours_finder_;
 
       void removalDiscontinuities();
 
     public:
-      Verifier(Data::HardPtr data, std::shared_ptr<Image> binary);
+      Verifier(Data::HardPtr data, std::shared_ptr<BinaryImage> binary);
 
       void setContoursFinder(ContoursFinder::HardPtr finder);
 
@@ -41,11 +43,18 @@ namespace xr
     Data::HardPtr data_;
     int target_index_ = -1;
     std::vector<Item> buffer_;
-    std::shared_ptr<Image> binary_ver_;
+    std::shared_ptr<BinaryImage> binary_ver_; // исходное, бинаризованное по Отсу
+    ContoursFinder::HardPtr contours_finder_;
+    std::vector<std::shared_ptr<Image>> candidates_; // копии working, переиспользуются между вызовами find
+
+    std::shared_ptr<Image> candidate(int index);
 
   public:
     ThresholdFinder(Data::HardPtr data);
 
+    // подготовка к новому содержимому data_ (после Data::assign), буферы сохраняются
+    virtual void reset();
+
     virtual uint8_t find(uint8_t approximation, double step, int count);
     virtual ThresholdFinder::Item& goodImage();
   };
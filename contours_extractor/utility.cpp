@@ -1,9 +1,10 @@
-﻿#include <map>
-#include <stack>
+﻿#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include "utility.h"
 #include "path_finder.h"
 #include "image_info.h"
+#include "contour_metrics.h"
 
 namespace xr
 {
@@ -54,22 +55,221 @@ namespace xr
     return (sum > 0) ? Orientation::Clockwise : Orientation::AntiClockwise;
   }
 
+  namespace
+  {
+    const uint8_t wall_color = 1;
+    const uint8_t outer_color = 128;
+    const int right_label = 0xffff;
+
+    /* Растр для нормализации контура. Кадр width x height окружен двумя кольцами:
+       внешнее (стена) останавливает заливку без проверки границ, внутреннее (фон)
+       соединяет всю внешнюю область, поэтому заливка делается один раз.
+       Соседи считаются сдвигом индекса, буферы переиспользуются в пределах потока. */
+    class FundamentalRaster {
+      int width_ = 0, height_ = 0, stride_ = 0;
+      int around_[8], cross_[8];
+      std::vector<uint8_t> pixels_;
+      std::vector<int> labels_;
+      std::vector<int> lwave_, rwave_, next_;
+
+      int index(int x, int y) const {
+        return (x + 2) + (y + 2) * stride_;
+      }
+
+      point_t point(int index) const {
+        return point_t(index % stride_ - 2, index / stride_ - 2);
+      }
+
+      int findNormalPoint() const;
+      void backtrace(std::vector<int>& path, int last_label) const;
+
+    public:
+      void reset(int width, int height);
+
+      uint8_t& at(int x, int y) {
+        return pixels_[index(x, y)];
+      }
+
+      // контур кадра по часовой стрелке, координаты уменьшены на (1, 1)
+      contour_t trace();
+    };
+
+    void FundamentalRaster::reset(int width, int height) {
+      width_ = width;
+      height_ = height;
+      stride_ = width + 4;
+      for (int i = 0; i < 8; ++i) {
+        around_[i] = math::cdx[i] + math::cdy[i] * stride_;
+        cross_[i] = math::dx[i] + math::dy[i] * stride_;
+      }
+
+      pixels_.assign(stride_ * (height + 4), 0);
+      labels_.assign(pixels_.size(), 0);
+      for (int x = 0; x < stride_; ++x) {
+        pixels_[x] = pixels_[pixels_.size() - stride_ + x] = wall_color;
+      }
+
+      for (int y = 0; y < height + 4; ++y) {
+        pixels_[y * stride_] = pixels_[y * stride_ + stride_ - 1] = wall_color;
+      }
+    }
+
+    int FundamentalRaster::findNormalPoint() const {
+      for (int j = 1; j < height_ - 1; ++j) {
+        for (int i = 1; i < width_ - 1; ++i) {
+          int cur = index(i, j);
+          if (pixels_[cur] != 255) continue;
+
+          int count = 0;
+          for (int k = 0; k < 8; ++k) {
+            count += (pixels_[cur + around_[k]] == 255);
+          }
+
+          if (count != 2) continue;
+
+          bool background = false, outer = false;
+          for (int k = 0; k < 4; ++k) {
+            background |= (pixels_[cur + cross_[k]] == 0);
+            outer |= (pixels_[cur + cross_[k]] == outer_color);
+          }
+
+          if (background && outer) return cur;
+        }
+      }
+
+      throw std::runtime_error("error in findNormalContourPoint(..)!");
+    }
+
+    void FundamentalRaster::backtrace(std::vector<int>& path, int last_label) const {
+      int counter = labels_[path.back()];
+      while (labels_[path.back()] != last_label) {
+        --counter;
+        int cur = path.back();
+        for (int i = 0; i < 8; ++i) {
+          if (labels_[cur + cross_[i]] == counter) {
+            path.push_back(cur + cross_[i]);
+            break;
+          }
+        }
+      }
+    }
+
+    contour_t FundamentalRaster::trace() {
+      /* внешний фон */
+      int start = index(-1, -1);
+      pixels_[start] = outer_color;
+      next_.assign(1, start);
+      while (!next_.empty()) {
+        int cur = next_.back();
+        next_.pop_back();
+        for (int i = 0; i < 4; ++i) {
+          int neighbor = cur + cross_[i];
+          if (pixels_[neighbor] == 0) {
+            pixels_[neighbor] = outer_color;
+            next_.push_back(neighbor);
+          }
+        }
+      }
+
+      int first = findNormalPoint();
+      int front = -1, back = -1;
+      for (int i = 0; i < 8; ++i) {
+        if (pixels_[first + around_[i]] == 255) {
+          if (front < 0) front = first + around_[i];
+          back = first + around_[i];
+        }
+      }
+
+      if (point(front).dist(point(back)) <= 1) {
+        throw std::runtime_error("error in leadToFundamental(..)!");
+      }
+
+      labels_[first] = 1;
+      labels_[back] = 2;
+      labels_[front] = right_label;
+      lwave_.assign(1, back);
+      rwave_.assign(1, front);
+      next_.clear();
+      /* пускаем две волны в разные стороны, пока не встретятся */
+      std::vector<int> lhs, rhs;
+      while (rhs.empty()) {
+        if (lwave_.empty() && rwave_.empty()) {
+          throw std::runtime_error("error in leadToFundamental(..)! волны не встретились");
+        }
+
+        // левая волна
+        while (!lwave_.empty()) {
+          int cur = lwave_.back();
+          lwave_.pop_back();
+          for (int i = 0; i < 8; ++i) {
+            int neighbor = cur + around_[i];
+            if (pixels_[neighbor] == 255 && !labels_[neighbor]) {
+              next_.push_back(neighbor);
+              labels_[neighbor] = labels_[cur] + 1;
+            }
+          }
+        }
+
+        lwave_.swap(next_);
+
+        // правая волна
+        while (!rwave_.empty()) {
+          int cur = rwave_.back();
+          rwave_.pop_back();
+          for (int i = 0; i < 8; ++i) {
+            int neighbor = cur + around_[i];
+            if (pixels_[neighbor] != 255) continue;
+
+            if (!labels_[neighbor]) {
+              next_.push_back(neighbor);
+              labels_[neighbor] = labels_[cur] + 1;
+            }
+            else if (1 < labels_[neighbor] && labels_[neighbor] < right_label) {
+              // волны встретились
+              rhs.push_back(cur);
+              lhs.push_back(neighbor);
+              break;
+            }
+          }
+        }
+
+        rwave_.swap(next_);
+      }
+
+      /* обратная трассировка */
+      backtrace(lhs, 1);
+      backtrace(rhs, right_label);
+
+      /* вспомним про рамку, учтем в координатах */
+      contour_t dst;
+      dst.reserve(lhs.size() + rhs.size());
+      for (auto it = lhs.rbegin(); it != lhs.rend(); ++it) {
+        dst.push_back(point(*it) - point_t(1, 1));
+      }
+
+      for (auto it = rhs.begin(); it != rhs.end(); ++it) {
+        dst.push_back(point(*it) - point_t(1, 1));
+      }
+
+      /* ВАЖНО! обход контура должен производиться по часовой стрелке; поэтому такой return */
+      if (orientation(dst) != Orientation::Clockwise) {
+        std::reverse(dst.begin(), dst.end());
+      }
+
+      return dst;
+    }
+
+    FundamentalRaster& fundamentalRaster() {
+      static thread_local FundamentalRaster raster;
+      return raster;
+    }
+  }
+
   contour_t getContourByRosenfeld(const Image& image) {
     if (!info::hasFrame(image, 0) || info::isEmpty(image)) {
       throw std::logic_error("неподходящее изображение! нет рамки с фоном или пустое!");
     }
 
-    std::map<point_t, int> mask = {
-      { point_t(-1, -1), 0 },
-      { point_t(0, -1), 1 },
-      { point_t(1, -1), 2 },
-      { point_t(1, 0), 3 },
-      { point_t(1, 1), 4 },
-      { point_t(0, 1), 5 },
-      { point_t(-1, 1), 6 },
-      { point_t(-1, 0), 7 }
-    };
-
     /* определяем первую точку */
     int x = 0, y = 0;
     while (image.byte(x, y) != 255) {
@@ -92,7 +292,7 @@ namespace xr
       dst.push_back(make_point(x, y));
       temp_x = (dst.end() - 2)->x - dst.back().x;
       temp_y = (dst.end() - 2)->y - dst.back().y;
-      start_index = mask[make_point(temp_x, temp_y)] + 1;
+      start_index = math::cindex[(temp_y + 1) * 3 + temp_x + 1] + 1;
       for (int i = start_index; i<start_index + 8 && image.byte(x, y) != 255; ++i) {
         real_index = math::normalize(i, 8);
         x = dst.back().x + math::cdx[real_index];
@@ -104,150 +304,41 @@ namespace xr
     return dst;
   }
 
-  point_t findNormalContourPoint(const Image& image) {
-    Image aux(image);
-    int top = aux.height() - 1;
-    int right = aux.width() - 1;
-    const uint8_t temp_color = 128;
-    if (aux.byte(0, 0) == 0) aux.floodFill(0, 0, temp_color, Connectivity::Four);
-    if (aux.byte(right, 0) == 0) aux.floodFill(right, 0, temp_color, Connectivity::Four);
-    if (aux.byte(0, top) == 0) aux.floodFill(0, top, temp_color, Connectivity::Four);
-    if (aux.byte(right, top) == 0) aux.floodFill(right, top, temp_color, Connectivity::Four);
-
-    for (int j = 1; j < aux.height() - 1; ++j) {
-      for (int i = 1; i < aux.width() - 1; ++i) {
-        if (aux.byte(i, j) == 255 && info::neighborsNumber(image, i, j) == 2 &&
-          info::isAdjacentColor4w(aux, i, j, 0) && info::isAdjacentColor4w(aux, i, j, temp_color)) 
-        {
-          return point_t(i, j);
-        }
-      }
-    }
-
-    throw std::runtime_error("error in findNormalContourPoint(..)!");
-    return point_t();
-  }
-
   contour_t toFundamental(const Image& src) {
-    Matrix<int> labels(src.size(), 0);
-    auto point = findNormalContourPoint(src);
-    if (point.x == 0 && point.y == 0) {
-      return contour_t();
-    }
-
-    points_t neighbors = info::neighborsPixel(src, point.x, point.y);
-    if (neighbors.front().dist(neighbors.back()) <= 1) {
-      throw std::runtime_error("error in leadToFundamental(..)!");
-    }
-
-    labels(point) = 1;
-    labels(neighbors.back()) = 2;
-    labels(neighbors.front()) = 0xffff;
-    std::stack<point_t> lstack, rstack, tmp_stack;
-    lstack.push(neighbors.back());
-    rstack.push(neighbors.front());
-    /* пускаем две волны в разные стороны, пока не встретятся */
-    int x, y;
-    point_t cur;
-    points_t lhs, rhs;
-    while (rhs.empty()) {
-      // левая волна
-      tmp_stack = std::stack<point_t>();
-      while (!lstack.empty()) {
-        cur = lstack.top();
-        lstack.pop();
-        for (int i = 0; i < 8; ++i) {
-          x = cur.x + math::cdx[i];
-          y = cur.y + math::cdy[i];
-          if (src.byte(x, y) == 255 && !labels(x, y)) {
-            tmp_stack.push(point_t(x, y));
-            labels(x, y) = labels(cur) + 1;
-          }
-        }
-      }
-
-      lstack.swap(tmp_stack);
-
-      // правая волна
-      while (!rstack.empty()) {
-        cur = rstack.top();
-        rstack.pop();
-        for (int i = 0; i < 8; ++i) {
-          x = cur.x + math::cdx[i];
-          y = cur.y + math::cdy[i];
-          if (src.byte(x, y) == 255) {
-            if (!labels(x, y)) {
-              tmp_stack.push(point_t(x, y));
-              labels(x, y) = labels(cur) + 1;
-            }
-            else if (1 < labels(x, y) && labels(x, y) < 0xffff) {
-              // волны встретились
-              rhs.push_back(cur);
-              lhs.push_back(point_t(x, y));
-              break;
-            }
-          }
-        }
-      }
-
-      rstack.swap(tmp_stack);
-    }
-
-    /* обратная трассировка */
-    int counter = labels(lhs.back());
-    while (labels(lhs.back()) != 1) { // lhs
-      --counter;
-      cur = lhs.back();
-      for (int i = 0; i<8; ++i) {
-        if (labels(point_t(cur.x + math::dx[i], cur.y + math::dy[i])) == counter) {
-          lhs.push_back(point_t(cur.x + math::dx[i], cur.y + math::dy[i]));
-          break;
-        }
+    auto& raster = fundamentalRaster();
+    raster.reset(src.width(), src.height());
+    for (int y = 0; y < src.height(); ++y) {
+      for (int x = 0; x < src.width(); ++x) {
+        raster.at(x, y) = src.byte(x, y);
       }
     }
 
-    counter = labels(rhs.back());
-    while (labels(rhs.back()) != 0xffff) { // rhs
-      --counter;
-      cur = rhs.back();
-      for (int i = 0; i<8; ++i) {
-        if (labels(point_t(cur.x + math::dx[i], cur.y + math::dy[i])) == counter) {
-          rhs.push_back(point_t(cur.x + math::dx[i], cur.y + math::dy[i]));
-          break;
-        }
-      }
-    }
-
-    rhs.insert(rhs.begin(), lhs.rbegin(), lhs.rend());
-
-    /* вспомним про рамку, учтем в координатах */
-    for (auto& it : rhs) {
-      it -= point_t(1, 1);
-    }
-
-    /* ВАЖНО! обход контура должен производиться по часовой стрелке; поэтому такой return */
-    if (orientation(rhs) == Orientation::Clockwise) return rhs;
-    return contour_t(rhs.rbegin(), rhs.rend());
+    return raster.trace();
   }
 
   contour_t toFundamental(const contour_t& src) {
     if (src.size() < 16) return contour_t();
 
-    Image pixmap(std::move(Image::draw(src, 1)));
+    /* контур рисуется сразу в растр размером с его рамку (с полем в 1 пиксель) */
+    auto rect = createBoundingRect(src);
+    auto& raster = fundamentalRaster();
+    raster.reset(rect.right - rect.left + 3, rect.top - rect.bottom + 3);
+    for (auto& pt : src) {
+      raster.at(pt.x - rect.left + 1, pt.y - rect.bottom + 1) = 255;
+    }
+
     contour_t result;
     try {
-      result = toFundamental(pixmap);
+      result = raster.trace();
 
-      if (!result.empty()) { // восстановим координаты
-        auto rect = createBoundingRect(src);
-        for (auto it = result.begin(); it != result.end(); ++it) {
-          it->x += rect.left;
-          it->y += rect.bottom;
-        }
+      // восстановим координаты
+      for (auto it = result.begin(); it != result.end(); ++it) {
+        it->x += rect.left;
+        it->y += rect.bottom;
       }
     }
     catch (const std::exception& e) {
-      xr::imwrite(pixmap, "broken-image.png");
+      xr::imwrite(Image::draw(src, 1), "broken-image.png");
       std::cerr << "exception: " << e.what() << std::endl;
       result = src;
     }
@@ -305,117 +396,102 @@ namespace xr
   }
 
   double rmsError(const contour_t& first, const contour_t& other) {
-    contour_t second(first.size());
-    for (size_t i = 0; i < first.size(); ++i) {
-      point_t target;
-      auto& current = first[i];
-      double min_dist = Double::max();
-      for (auto& e : other) {
-        auto d = xr::dist(current, e);
-        if (d < min_dist) {
-          min_dist = d;
-          target = e;
-        }
-      }
+    return compareContour(first, other).rms_error;
+  }
 
-      second[i] = target;
-    }
+  double meanDistance(const contour_t& first, const contour_t& other) {
+    return compareContour(first, other).mean_distance;
+  }
 
-    double sum = 0.0;
-    for (size_t i = 0; i < first.size(); ++i) {
-      sum += xr::sqrDist(first[i], second[i]);
-    }
+  double standartDeviation(const contour_t& first, const contour_t& other) {
+    return compareContour(first, other).deviation;
+  }
 
-    return sqrt(sum / first.size());
+  double hausdorfDistance(const contour_t& first, const contour_t& other) {
+    return compareContour(first, other).hausdorff;
   }
 
-  double meanDistance(const contour_t& first, const contour_t& other) {
-    contour_t second(first.size());
-    for (size_t i = 0; i < first.size(); ++i) {
-      point_t target;
-      auto& current = first[i];
-      double min_dist = Double::max();
-      for (auto& e : other) {
-        auto d = xr::dist(current, e);
-        if (d < min_dist) {
-          min_dist = d;
-          target = e;
-        }
-      }
+  ContoursDeviation compareContours(const contours_t& baseline, const contours_t& other) {
+    ContoursDeviation dst;
+    dst.baseline_count = baseline.size();
+    dst.count = other.size();
 
-      second[i] = target;
+    // индексы строятся один раз на контур, а не на каждую пару
+    std::vector<ContourIndex> indexes;
+    indexes.reserve(other.size());
+    for (auto& contour : other) {
+      indexes.emplace_back(contour);
     }
 
-    double sum = 0.0;
-    for (size_t i = 0; i < first.size(); ++i) {
-      sum += xr::dist(first[i], second[i]);
-    }
+    size_t matched = 0;
+    std::vector<bool> used(other.size(), false);
+    for (auto& contour : baseline) {
+      int target = -1;
+      double min_dist = Double::max();
+      for (size_t k = 0; k < other.size(); ++k) {
+        if (used[k] || other[k].empty() || contour.empty()) continue;
 
-    return sum / first.size();
-  }
+        double sum = 0.0;
+        for (auto& pt : contour) {
+          sum += indexes[k].nearest(pt);
+        }
 
-  double standartDeviation(const contour_t& first, const contour_t& other) {
-    contour_t second(first.size());
-    for (size_t i = 0; i < first.size(); ++i) {
-      point_t target;
-      auto& current = first[i];
-      double min_dist = Double::max();
-      for (auto& e : other) {
-        auto d = xr::dist(current, e);
+        auto d = sum / contour.size();
         if (d < min_dist) {
           min_dist = d;
-          target = e;
+          target = static_cast<int>(k);
         }
       }
 
-      second[i] = target;
-    }
+      if (target < 0) {
+        ++dst.unmatched;
+        continue;
+      }
 
-    double mean = 0.0;
-    for (size_t i = 0; i < first.size(); ++i) {
-      mean += xr::dist(first[i], second[i]);
+      used[target] = true;
+      dst.mean_distance += min_dist;
+      dst.max_distance = std::max(dst.max_distance, compareContour(contour, ContourIndex(contour), other[target], indexes[target]).hausdorff);
+      ++matched;
     }
 
-    mean /= first.size();
+    if (matched) dst.mean_distance /= matched;
+    return dst;
+  }
 
-    double dev = 0.0;
-    for (size_t i = 0; i < first.size(); ++i) {
-      dev += xr::math::sqr(xr::dist(first[i], second[i]) - mean);
+  bool saveContours(const contours_t& src, const std::string& filename) {
+    std::ofstream out(filename);
+    if (!out) return false;
+
+    out << src.size() << std::endl;
+    for (auto& contour : src) {
+      out << contour.size();
+      for (auto& pt : contour) {
+        out << " " << pt.x << " " << pt.y;
+      }
+      out << std::endl;
     }
 
-    return sqrt(dev / first.size());
+    return static_cast<bool>(out);
   }
 
-  double hausdorfDistance(const contour_t& first, const contour_t& other) {
-    contour_t second(first.size());
-    for (size_t i = 0; i < first.size(); ++i) {
-      point_t target;
-      auto& current = first[i];
-      double min_dist = Double::max();
-      for (auto& e : other) {
-        auto d = xr::dist(current, e);
-        if (d < min_dist) {
-          min_dist = d;
-          target = e;
-        }
-      }
+  contours_t loadContours(const std::string& filename) {
+    std::ifstream in(filename);
+    if (!in) throw std::runtime_error("can't open " + filename);
 
-      second[i] = target;
-    }
+    size_t count = 0;
+    in >> count;
 
-    size_t n = first.size();
-    double sup_x = Double::min(), sup_y = Double::min();
-    for (size_t i = 0; i < n; ++i) {
-      double inf_x = Double::max(), inf_y = Double::max();
-      for (size_t k = 0; k < n; ++k) {
-        inf_x = std::min(inf_x, xr::dist(first[i], second[k]));
-        inf_y = std::min(inf_y, xr::dist(second[i], first[k]));
+    contours_t dst(count);
+    for (auto& contour : dst) {
+      size_t n = 0;
+      in >> n;
+      contour.resize(n);
+      for (auto& pt : contour) {
+        in >> pt.x >> pt.y;
       }
-
-      sup_x = std::max(sup_x, inf_x);
-      sup_y = std::max(sup_y, inf_y);
     }
 
-    return std::max(sup_x, sup_y);
+    if (in.fail()) throw std::runtime_error("bad contours file " + filename);
+    return dst;
   }
-}
\ No newline at end of file
+}
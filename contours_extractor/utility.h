@@ -68,4 +68,20 @@ namespace xr
   double standartDeviation(const contour_t& first, const contour_t& other);
 
   double hausdorfDistance(const contour_t& first, const contour_t& other);
+
+  //      (, float-  double-)
+  struct ContoursDeviation {
+    size_t baseline_count = 0;
+    size_t count = 0;
+    size_t unmatched = 0; //  ,     
+    double mean_distance = 0.0; //     
+    double max_distance = 0.0; //     
+  };
+
+  //      (  )  other
+  ContoursDeviation compareContours(const contours_t& baseline, const contours_t& other);
+
+  //  :  ,    -     
+  bool saveContours(const contours_t& src, const std::string& filename);
+  contours_t loadContours(const std::string& filename);
 }
@@ -36,6 +36,13 @@ namespace xr
       return 2 * math::Pi - math::Pi_4;
     }
 
+    int roundDirCode(double angle) {
+      if (angle <= 22.5 && angle > -22.5) return 0;
+      if ((angle > 22.5 && angle <= 67.5) || (angle <= -112.5 && angle > -157.5)) return 1;
+      if ((angle > 67.5 && angle <= 112.5) || (angle <= -67.5 && angle > -112.5)) return 2;
+      return 3;
+    }
+
     double dirDist(double f_anfle, double s_angle) {
       return math::min(abs(f_anfle - s_angle), abs(f_anfle + 2.0*math::Pi - s_angle));
     }
@@ -16,6 +16,9 @@ namespace xr
     const int cdx[8] = { -1, 0, 1, 1, 1, 0, -1, -1 };
     const int cdy[8] = { -1, -1, -1, 0, 1, 1, 1, 0 };
 
+    // номер соседа в cdx, cdy по смещению: cindex[(dy + 1) * 3 + dx + 1]
+    const int cindex[9] = { 0, 1, 2, 7, 0, 3, 6, 5, 4 };
+
     template<class T>
     inline T min(T a, T b) {
       return (a < b) ? a : b;
@@ -65,6 +68,10 @@ namespace xr
     // округляет направление до ближайшего 45-градусного деления
     double roundDir(double angle);
 
+    // ось направления roundDir(angle) без учёта знака: 0 - (1, 0), 1 - (1, 1), 2 - (0, 1), 3 - (1, -1);
+    // как и у roundDir, |angle| > 157.5 попадает в 3
+    int roundDirCode(double angle);
+
     // расстояние между направлениями (в радианах)
     double dirDist(double angle1, double angle2);
   }
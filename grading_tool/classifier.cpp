@@ -2,16 +2,48 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QDebug>
-#include <QFile>
+#include <QElapsedTimer>
+
+#undef slots
+#include <ATen/Parallel.h>
+#include <caffe2/serialize/read_adapter_interface.h>
+#define slots Q_SLOTS
 
 #include "zip/qzipreader.h"
 
+namespace {
+  // gives libtorch direct access to the model bytes (without temp file and copies)
+  class ByteArrayReadAdapter : public caffe2::serialize::ReadAdapterInterface {
+    QByteArray data_;
+
+  public:
+    explicit ByteArrayReadAdapter(const QByteArray& data) :
+      data_(data) {
+    }
+
+    size_t size() const override {
+      return static_cast<size_t>(data_.size());
+    }
+
+    size_t read(uint64_t pos, void* buf, size_t n, const char* /*what*/ = "") const override {
+      if (pos >= size()) return 0;
+
+      n = std::min<size_t>(n, size() - static_cast<size_t>(pos));
+      memcpy(buf, data_.constData() + pos, n);
+      return n;
+    }
+  };
+}
+
 bool Classifier::initFromResource(const QString& filename) {
   if (path_ == filename)
     return true;
 
   path_ = filename;
 
+  QElapsedTimer timer;
+  timer.start();
+
   // читаем архив
   QJsonParseError parse_error;
   QZipReader zip_reader(filename);
@@ -44,17 +76,12 @@ bool Classifier::initFromResource(const QString& filename) {
     return false;
   }
 
-  // обученная модель НС
-  QFile file("scripted.pth");
-  file.remove();
-
-  file.open(QIODevice::WriteOnly);
-  file.write(cnn_weights_data);
-  file.close();
-  file.setPermissions(QFileDevice::WriteUser | QFileDevice::ReadUser | QFileDevice::ExeUser);
+  // старые модели принимают одно изображение H x W x 3
+  batched_ = meta_data["batched"].toBool(false);
 
+  // обученная модель НС (загружаем прямо из памяти)
   try {
-    module_ = torch::jit::load(file.fileName().toStdString());
+    module_ = torch::jit::load(std::make_shared<ByteArrayReadAdapter>(cnn_weights_data));
   }
   catch (c10::Error& e) {
     last_error_ = e.what_without_backtrace();
@@ -65,11 +92,26 @@ bool Classifier::initFromResource(const QString& filename) {
     return false;
   }
 
-  file.remove();
-
+  qDebug() << "model" << filename << "loaded in" << timer.elapsed() << "ms";
   return true;
 }
 
+void Classifier::setNumThreads(int intra_op, int inter_op) {
+  if (intra_op > 0) {
+    at::set_num_threads(intra_op);
+  }
+
+  if (inter_op > 0 && at::get_num_interop_threads() != inter_op) {
+    try {
+      at::set_num_interop_threads(inter_op);
+    }
+    catch (c10::Error& e) {
+      // пул уже запущен - оставляем как есть
+      qWarning() << e.what_without_backtrace();
+    }
+  }
+}
+
 QString Classifier::header(int idx) const {
   if (idx < header_.size()) {
     return header_[idx];
@@ -82,7 +124,20 @@ cv::Size Classifier::getFrameSize() const {
   return input_size_;
 }
 
+QVector<Classifier::Item> Classifier::makeItems(const float* data, int64_t count) const {
+  QVector<Item> answer(count);
+  for (auto i = 0; i < count; ++i) {
+    answer[i] = { header(i), data[i] };
+  }
+
+  return answer;
+}
+
 QVector<Classifier::Item> Classifier::getGrade(const Classifier::InputData& img) {
+  if (batched_) {
+    return getGrades({ img }).front();
+  }
+
   // формируем входные данные модели
   torch::Tensor tensor_img = torch::from_blob(img.data, { img.rows, img.cols, 3 }, torch::kByte);
 
@@ -91,14 +146,55 @@ QVector<Classifier::Item> Classifier::getGrade(const Classifier::InputData& img)
 
   auto output = module_.forward({ tensor_img });
   auto tensor = output.toTensor();
-  auto softmax = tensor.softmax(0);
+  auto softmax = tensor.softmax(0).contiguous();
 
-  auto count = softmax.size(0);
-  float* data = static_cast<float*>(softmax.data_ptr());
+  return makeItems(softmax.data_ptr<float>(), softmax.size(0));
+}
 
-  QVector<Item> answer(count);
-  for (auto i = 0; i < count; ++i) {
-    answer[i] = { header(i), data[i] };
+QVector<QVector<Classifier::Item>> Classifier::getGrades(const std::vector<Classifier::InputData>& images) {
+  QVector<QVector<Item>> answer;
+  if (images.empty()) {
+    return answer;
+  }
+
+  // модель без пакетного входа - по одному
+  if (!batched_) {
+    for (const auto& img : images) {
+      answer.push_back(getGrade(img));
+    }
+
+    return answer;
+  }
+
+  // собираем один тензор N x H x W x 3
+  auto count = static_cast<int64_t>(images.size());
+  auto batch = torch::empty({ count, input_size_.height, input_size_.width, 3 }, torch::kByte);
+  auto frame_bytes = static_cast<size_t>(input_size_.area()) * 3;
+
+  uint8_t* dst = batch.data_ptr<uint8_t>();
+  for (const auto& img : images) {
+    cv::Mat frame = img;
+    if (frame.size() != input_size_) {
+      cv::resize(img, frame, input_size_);
+    }
+    else if (!frame.isContinuous()) {
+      frame = img.clone();
+    }
+
+    memcpy(dst, frame.data, frame_bytes);
+    dst += frame_bytes;
+  }
+
+  // запускаем
+  torch::NoGradGuard no_grad;
+
+  auto output = module_.forward({ batch });
+  auto softmax = output.toTensor().softmax(1).contiguous();
+
+  const float* data = softmax.data_ptr<float>();
+  auto classes = softmax.size(1);
+  for (int64_t i = 0; i < count; ++i) {
+    answer.push_back(makeItems(data + i * classes, classes));
   }
 
   return answer;
@@ -1,5 +1,6 @@
 #pragma once
 #include <QString>
+#include <QVector>
 #include <QStringList>
 #pragma warning (disable: 4100)
 #pragma warning (disable: 4101)
@@ -25,14 +26,23 @@ protected:
   QString last_error_;
   QStringList header_;
   cv::Size input_size_;
+  bool batched_ = false; // model accepts N x H x W x 3 input
   torch::jit::script::Module module_;
 
+  QVector<Item> makeItems(const float* data, int64_t count) const;
+
 public:
   bool initFromResource(const QString& filename);
 
+  // intra-op and inter-op thread pools of libtorch (inter-op can be set only once per process)
+  static void setNumThreads(int intra_op, int inter_op);
+
   QString header(int idx) const;
   cv::Size getFrameSize() const;
   QVector<Item> getGrade(const InputData& input_data);
+
+  // classify all images with one forward pass (for batched models)
+  QVector<QVector<Item>> getGrades(const std::vector<InputData>& input_data);
 };
 
 #pragma warning (default: 4267)
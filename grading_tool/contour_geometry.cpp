@@ -0,0 +1,138 @@
+#include "contour_geometry.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#include "utils.h"
+
+std::vector<Span> rasterize(const QPolygonF& poly, const QRect& clip) {
+  struct Edge {
+    qreal y_begin, y_end; // the edge crosses rows y_begin <= y < y_end
+    qreal x, dxdy;        // x at y_begin and its increment per row
+  };
+
+  std::vector<Span> ans;
+  const int n = poly.size();
+  if (n < 3) {
+    return ans;
+  }
+
+  std::vector<Edge> edges;
+  edges.reserve(n);
+  for (int k = 0; k < n; ++k) {
+    auto p = poly[k], q = poly[(k + 1) % n];
+    if (p.y() == q.y()) continue;
+    if (p.y() > q.y()) std::swap(p, q);
+
+    edges.push_back({ p.y(), q.y(), p.x(), (q.x() - p.x()) / (q.y() - p.y()) });
+  }
+
+  std::sort(edges.begin(), edges.end(), [](const Edge& lhs, const Edge& rhs) {
+    return lhs.y_begin < rhs.y_begin;
+  });
+
+  auto bounds = poly.boundingRect();
+  int first_row = static_cast<int>(std::ceil(bounds.top()));
+  int last_row = static_cast<int>(std::floor(bounds.bottom()));
+  int left = INT_MIN, right = INT_MAX;
+  if (!clip.isNull()) {
+    first_row = std::max(first_row, clip.top());
+    last_row = std::min(last_row, clip.bottom());
+    left = clip.left();
+    right = clip.right();
+  }
+
+  size_t next = 0;
+  std::vector<const Edge*> active;
+  std::vector<qreal> xs;
+  for (int y = first_row; y <= last_row; ++y) {
+    while (next < edges.size() && edges[next].y_begin <= y) {
+      active.push_back(&edges[next++]);
+    }
+
+    active.erase(std::remove_if(active.begin(), active.end(), [y](const Edge* e) {
+      return e->y_end <= y;
+    }), active.end());
+
+    xs.clear();
+    for (auto e : active) {
+      xs.push_back(e->x + (y - e->y_begin) * e->dxdy);
+    }
+
+    std::sort(xs.begin(), xs.end());
+    for (size_t k = 0; k + 1 < xs.size(); k += 2) {
+      int x_begin = std::max(left, static_cast<int>(std::ceil(xs[k])));
+      int x_end = std::min(right, static_cast<int>(std::floor(xs[k + 1])));
+      if (x_begin <= x_end) {
+        ans.push_back({ y, x_begin, x_end });
+      }
+    }
+  }
+
+  return ans;
+}
+
+qreal area(const QPolygonF& poly) {
+  qreal acc = 0.0;
+  for (int k = 0, n = poly.size(); k < n; ++k) {
+    const auto& p = poly[k];
+    const auto& q = poly[(k + 1) % n];
+    acc += p.x() * q.y() - q.x() * p.y();
+  }
+
+  return std::abs(acc) * 0.5;
+}
+
+qreal perimeter(const QPolygonF& poly) {
+  if (poly.isEmpty()) {
+    return 0.0;
+  }
+
+  qreal acc = 0.0f;
+  acc += dist(poly.last(), poly.first());
+  for (int k = 1; k < poly.count(); ++k) {
+    acc += dist(poly[k - 1], poly[k]);
+  }
+
+  return acc;
+}
+
+qreal square(const QPolygonF& poly) {
+  int count = 0;
+  for (const auto& span : rasterize(poly)) {
+    count += span.x_end - span.x_begin + 1;
+  }
+
+  return count;
+}
+
+ContourMeasures measure(const QPolygonF& poly) {
+  ContourMeasures ans;
+  ans.area = area(poly);
+  ans.perimeter = perimeter(poly);
+  ans.pixels = static_cast<int>(square(poly));
+  return ans;
+}
+
+qreal max_width(const xr::contour_t& contour) {
+  if (contour.empty()) {
+    return 0.0;
+  }
+
+  auto r = rect(contour);
+
+  // extreme x of every row
+  std::vector<int> min_x(r.height + 1, INT_MAX), max_x(r.height + 1, INT_MIN);
+  for (const auto& pt : contour) {
+    auto row = pt.y - r.y;
+    min_x[row] = std::min<int>(min_x[row], pt.x);
+    max_x[row] = std::max<int>(max_x[row], pt.x);
+  }
+
+  int ans = 0;
+  for (int row = 0; row <= r.height; ++row) {
+    if (max_x[row] != INT_MIN) ans = std::max(ans, max_x[row] - min_x[row]);
+  }
+
+  return ans;
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <vector>
+#include <QPolygonF>
+#include <QRect>
+#include <defs.h>
+
+// Run of pixels [x_begin, x_end] of row y inside a polygon
+struct Span {
+  int y;
+  int x_begin;
+  int x_end;
+};
+
+// Measures of a closed contour, computed once and used for filtering and ordering
+struct ContourMeasures {
+  qreal area = 0.0;      // shoelace area of the polygon
+  qreal perimeter = 0.0;
+  int pixels = 0;        // number of pixels inside (scanline)
+};
+
+// spans of pixels whose centers are inside the polygon (odd-even rule), rows are clipped by clip;
+// an active edge table is used, so the cost is O(n log n + rows * crossings)
+std::vector<Span> rasterize(const QPolygonF& poly, const QRect& clip = QRect());
+
+// absolute area by the shoelace formula, O(n)
+qreal area(const QPolygonF& poly);
+qreal perimeter(const QPolygonF& poly);
+
+// number of pixels inside the polygon
+qreal square(const QPolygonF& poly);
+
+ContourMeasures measure(const QPolygonF& poly);
+
+// maximal distance between points of one row, O(n + rows)
+qreal max_width(const xr::contour_t& contour);
@@ -0,0 +1,187 @@
+#include "dicom_reader.h"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+#include <gdcm/gdcmImageReader.h>
+#include <gdcm/gdcmAttribute.h>
+
+namespace {
+  // linear VOI window (DICOM PS3.3 C.11.2.1.2)
+  struct Window {
+    double center = 0.0;
+    double width = 0.0; // 0 - not specified
+
+    static Window fromRange(double low, double high) {
+      Window ans;
+      ans.center = (low + high) / 2 + 0.5;
+      ans.width = std::max(1.0, high - low + 1);
+      return ans;
+    }
+
+    uchar apply(double x) const {
+      auto w = std::max(1.0, width - 1);
+      return cv::saturate_cast<uchar>(((x - (center - 0.5)) / w + 0.5) * 255.0);
+    }
+  };
+
+  struct Params {
+    double slope = 1.0;
+    double intercept = 0.0;
+    Window window;
+    bool invert = false;
+    int bits_stored = 0;
+    DicomOptions options;
+  };
+
+  // stored values of up to 16 bits: histogram and LUT are indexed by the value itself
+  template<class T>
+  cv::Mat convertInteger(const T* src, int rows, int cols, const Params& p) {
+    static_assert(sizeof(T) <= 2, "LUT is for 8 and 16-bit values only");
+
+    const int offset = std::numeric_limits<T>::is_signed ? -static_cast<int>(std::numeric_limits<T>::min()) : 0;
+    const size_t lut_size = size_t(1) << (sizeof(T) * 8);
+    const size_t count = static_cast<size_t>(rows) * cols;
+
+    // high bits above the stored ones may contain overlays
+    int mask = -1;
+    if (!std::numeric_limits<T>::is_signed && p.bits_stored > 0 && p.bits_stored < static_cast<int>(sizeof(T) * 8)) {
+      mask = (1 << p.bits_stored) - 1;
+    }
+
+    auto value = [&](size_t idx) { return (static_cast<int>(idx) - offset) * p.slope + p.intercept; };
+
+    auto window = p.window;
+    if (p.options.auto_window || window.width <= 0) {
+      std::vector<size_t> hist(lut_size, 0);
+      for (size_t i = 0; i < count; ++i) {
+        ++hist[(src[i] & mask) + offset];
+      }
+
+      auto cut = static_cast<size_t>(count * p.options.percentile / 100);
+      size_t low = 0, high = lut_size - 1;
+      for (size_t sum = 0; low < lut_size - 1 && (sum += hist[low]) <= cut; ++low);
+      for (size_t sum = 0; high > low && (sum += hist[high]) <= cut; --high);
+
+      window = Window::fromRange(std::min(value(low), value(high)), std::max(value(low), value(high)));
+    }
+
+    std::vector<uchar> lut(lut_size);
+    for (size_t k = 0; k < lut_size; ++k) {
+      auto v = window.apply(value(k));
+      lut[k] = p.invert ? 255 - v : v;
+    }
+
+    cv::Mat ans(rows, cols, CV_8UC1);
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+      for (int y = range.start; y < range.end; ++y) {
+        auto s = src + static_cast<size_t>(y) * cols;
+        auto d = ans.ptr<uchar>(y);
+        for (int x = 0; x < cols; ++x) {
+          d[x] = lut[(s[x] & mask) + offset];
+        }
+      }
+    });
+
+    return ans;
+  }
+
+  // 32-bit and floating point values: the window is applied directly
+  template<class T>
+  cv::Mat convertGeneric(const T* src, int rows, int cols, const Params& p) {
+    const size_t count = static_cast<size_t>(rows) * cols;
+
+    auto window = p.window;
+    if (p.options.auto_window || window.width <= 0) {
+      // percentiles over a subsample of at most 1M values
+      std::vector<double> values;
+      size_t step = std::max<size_t>(1, count / (1 << 20));
+      for (size_t i = 0; i < count; i += step) {
+        values.push_back(src[i] * p.slope + p.intercept);
+      }
+
+      auto cut = static_cast<size_t>(values.size() * p.options.percentile / 100);
+      cut = std::min(cut, values.size() - 1);
+      std::nth_element(values.begin(), values.begin() + cut, values.end());
+      auto low = values[cut];
+      std::nth_element(values.begin(), values.end() - 1 - cut, values.end());
+      auto high = values[values.size() - 1 - cut];
+
+      window = Window::fromRange(low, high);
+    }
+
+    cv::Mat ans(rows, cols, CV_8UC1);
+    cv::parallel_for_(cv::Range(0, rows), [&](const cv::Range& range) {
+      for (int y = range.start; y < range.end; ++y) {
+        auto s = src + static_cast<size_t>(y) * cols;
+        auto d = ans.ptr<uchar>(y);
+        for (int x = 0; x < cols; ++x) {
+          auto v = window.apply(s[x] * p.slope + p.intercept);
+          d[x] = p.invert ? 255 - v : v;
+        }
+      }
+    });
+
+    return ans;
+  }
+}
+
+cv::Mat readDICOM(const QString& path, const DicomOptions& options) {
+  gdcm::ImageReader reader;
+  reader.SetFileName(path.toStdString().c_str());
+  if (!reader.Read()) {
+    throw std::runtime_error("Can't read DICOM file " + path.toStdString());
+  }
+
+  const auto& image = reader.GetImage();
+  const auto& pixel_format = image.GetPixelFormat();
+  int rows = image.GetRows();
+  int cols = image.GetColumns();
+
+  std::vector<char> buffer(image.GetBufferLength());
+  image.GetBuffer(buffer.data());
+
+  // color images (rare for radiographs) are just converted to gray
+  if (pixel_format.GetSamplesPerPixel() == 3) {
+    if (pixel_format.GetScalarType() != gdcm::PixelFormat::UINT8) {
+      throw std::runtime_error("Unsupported color format of image in DICOM!");
+    }
+
+    cv::Mat ans;
+    cv::cvtColor(cv::Mat(rows, cols, CV_8UC3, buffer.data()), ans, cv::COLOR_RGB2GRAY);
+    return ans;
+  }
+
+  Params p;
+  p.slope = image.GetSlope();
+  p.intercept = image.GetIntercept();
+  p.invert = image.GetPhotometricInterpretation() == gdcm::PhotometricInterpretation::MONOCHROME1;
+  p.bits_stored = pixel_format.GetBitsStored();
+  p.options = options;
+
+  // window of the file (the first one, if there are several)
+  const auto& ds = reader.GetFile().GetDataSet();
+  gdcm::Attribute<0x0028, 0x1050> center;
+  gdcm::Attribute<0x0028, 0x1051> width;
+  if (ds.FindDataElement(center.GetTag()) && ds.FindDataElement(width.GetTag())) {
+    center.SetFromDataSet(ds);
+    width.SetFromDataSet(ds);
+    if (center.GetNumberOfValues() > 0 && width.GetNumberOfValues() > 0) {
+      p.window.center = center.GetValue(0);
+      p.window.width = width.GetValue(0);
+    }
+  }
+
+  switch (pixel_format.GetScalarType()) {
+  case gdcm::PixelFormat::UINT8: return convertInteger(reinterpret_cast<const uint8_t*>(buffer.data()), rows, cols, p);
+  case gdcm::PixelFormat::INT8: return convertInteger(reinterpret_cast<const int8_t*>(buffer.data()), rows, cols, p);
+  case gdcm::PixelFormat::UINT16: return convertInteger(reinterpret_cast<const uint16_t*>(buffer.data()), rows, cols, p);
+  case gdcm::PixelFormat::INT16: return convertInteger(reinterpret_cast<const int16_t*>(buffer.data()), rows, cols, p);
+  case gdcm::PixelFormat::UINT32: return convertGeneric(reinterpret_cast<const uint32_t*>(buffer.data()), rows, cols, p);
+  case gdcm::PixelFormat::INT32: return convertGeneric(reinterpret_cast<const int32_t*>(buffer.data()), rows, cols, p);
+  case gdcm::PixelFormat::FLOAT32: return convertGeneric(reinterpret_cast<const float*>(buffer.data()), rows, cols, p);
+  case gdcm::PixelFormat::FLOAT64: return convertGeneric(reinterpret_cast<const double*>(buffer.data()), rows, cols, p);
+  default:
+    throw std::runtime_error("Unknown pixel format of image in DICOM!");
+  }
+}
@@ -0,0 +1,12 @@
+#pragma once
+#include <QString>
+#include <opencv2/opencv.hpp>
+
+struct DicomOptions {
+  bool auto_window = false; // ignore window of the file, take it from percentiles of pixel values
+  double percentile = 0.5;  // cut off by the automatic window at both ends, %
+};
+
+// decode image of DICOM file to 8-bit single channel plane: modality rescale (slope/intercept),
+// VOI window and MONOCHROME1 inversion are applied by one lookup table (throws std::runtime_error on failure)
+cv::Mat readDICOM(const QString& path, const DicomOptions& options = DicomOptions());
@@ -33,7 +33,13 @@ SOURCES += \
         utils.cpp \
         view_queue.cpp \
         viewport.cpp \
-        zip/qzip.cpp
+        zip/qzip.cpp \
+        inference_cache.cpp \
+        pipeline.cpp \
+        dicom_reader.cpp \
+        memory_manager.cpp \
+        tiled_image_item.cpp \
+        contour_geometry.cpp
 
 HEADERS += \
         mainwindow.h \
@@ -45,7 +51,13 @@ HEADERS += \
         view_queue.h \
         viewport.h \
         zip/qzipreader.h \
-        zip/qzipwriter.h
+        zip/qzipwriter.h \
+        inference_cache.h \
+        pipeline.h \
+        dicom_reader.h \
+        memory_manager.h \
+        tiled_image_item.h \
+        contour_geometry.h
 
 # torch
 # CONFIG += no_keywords
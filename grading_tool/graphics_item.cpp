@@ -4,9 +4,29 @@
 #include <QtMath>
 
 #include "utils.h"
+#include "contour_geometry.h"
 
 float GraphicsItem::base_touch_radius = 7.0f;
 
+namespace {
+  // statistics of the first channel over pixels inside the polygon, row by row
+  void spanStats(const cv::Mat& image, const QPolygonF& poly, int& sum, int& count, int& min, int& max) {
+    if (image.empty()) return;
+
+    const auto channels = image.channels();
+    for (const auto& span : rasterize(poly, QRect(0, 0, image.cols, image.rows))) {
+      auto row = image.ptr<uchar>(span.y);
+      for (int x = span.x_begin; x <= span.x_end; ++x) {
+        int px = row[x * channels];
+        min = qMin(px, min);
+        max = qMax(px, max);
+        sum += px;
+        count += 1;
+      }
+    }
+  }
+}
+
 GraphicsItem::GraphicsItem(QGraphicsItem* parent):
   QGraphicsItem(parent),
   item_(new GraphicsTextItem("", this)),
@@ -22,7 +42,7 @@ GraphicsItem::~GraphicsItem() {
   delete item_;
 }
 
-GraphicsItem* GraphicsItem::makeLine(const QPointF& p1, const QPointF& p2, QGraphicsPixmapItem* parent) {
+GraphicsItem* GraphicsItem::makeLine(const QPointF& p1, const QPointF& p2, TiledImageItem* parent) {
   auto item = new GraphicsItem(parent);
   item->line_ = new GraphicsLineItem(QLineF(p1, p2), item);
   item->type_ = Type::Line;
@@ -33,7 +53,7 @@ GraphicsItem* GraphicsItem::makeLine(const QPointF& p1, const QPointF& p2, QGrap
   return item;
 }
 
-GraphicsItem* GraphicsItem::makeEllipse(const QPointF& p1, const QPointF& p2, QGraphicsPixmapItem* parent) {
+GraphicsItem* GraphicsItem::makeEllipse(const QPointF& p1, const QPointF& p2, TiledImageItem* parent) {
   auto item = new GraphicsItem(parent);
   item->ellipse_ = new GraphicsEllipseItem(QRect(p1.toPoint(), p2.toPoint()), item);
   item->type_ = Type::Ellipse;
@@ -45,7 +65,7 @@ GraphicsItem* GraphicsItem::makeEllipse(const QPointF& p1, const QPointF& p2, QG
   return item;
 }
 
-GraphicsItem* GraphicsItem::makeAngle(const QPointF& pt, QGraphicsPixmapItem* parent) {
+GraphicsItem* GraphicsItem::makeAngle(const QPointF& pt, TiledImageItem* parent) {
   auto item = new GraphicsItem(parent);
   item->angle_ = new GraphicsAngleItem(QPolygonF({ pt, pt }), item);
   item->type_ = Type::Angle;
@@ -57,7 +77,7 @@ GraphicsItem* GraphicsItem::makeAngle(const QPointF& pt, QGraphicsPixmapItem* pa
   return item;
 }
 
-GraphicsItem* GraphicsItem::makeCobbAngle(const QPointF& pt, QGraphicsPixmapItem* parent) {
+GraphicsItem* GraphicsItem::makeCobbAngle(const QPointF& pt, TiledImageItem* parent) {
   auto item = new GraphicsItem(parent);
   item->cobb_angle_ = new GraphicsCobbAngleItem(QPolygonF({ pt }), item);
   item->type_ = Type::CobbAngle;
@@ -69,7 +89,7 @@ GraphicsItem* GraphicsItem::makeCobbAngle(const QPointF& pt, QGraphicsPixmapItem
   return item;
 }
 
-GraphicsItem* GraphicsItem::makePoly(const QPointF& pt, QGraphicsPixmapItem* parent) {
+GraphicsItem* GraphicsItem::makePoly(const QPointF& pt, TiledImageItem* parent) {
   auto item = new GraphicsItem(parent);
   item->poly_ = new GraphicsPolyItem(QPolygonF({ pt, pt }), item);
   item->type_ = Type::Poly;
@@ -81,7 +101,7 @@ GraphicsItem* GraphicsItem::makePoly(const QPointF& pt, QGraphicsPixmapItem* par
   return item;
 }
 
-GraphicsItem* GraphicsItem::makeSmartCurve(const QPointF& pt, QGraphicsPixmapItem* parent) {
+GraphicsItem* GraphicsItem::makeSmartCurve(const QPointF& pt, TiledImageItem* parent) {
   auto item = new GraphicsItem(parent);
   item->smart_curve_ = new SmartCurveItem({}, item);
   item->type_ = Type::SmartCurve;
@@ -93,14 +113,14 @@ GraphicsItem* GraphicsItem::makeSmartCurve(const QPointF& pt, QGraphicsPixmapIte
   return item;
 }
 
-GraphicsItem* GraphicsItem::makeFromJson(const QJsonObject& json, const QVector<Transformation>& transforms, int r, QGraphicsPixmapItem* parent) {
+GraphicsItem* GraphicsItem::makeFromJson(const QJsonObject& json, const QVector<Transformation>& transforms, int r, TiledImageItem* parent) {
   Q_UNUSED(r);
 
   auto item = new GraphicsItem(parent);
   item->rotation = r;
 
   auto type = json["type"].toString();
-  auto sz = parent->pixmap().size();
+  auto sz = parent->size();
   if (type == "line") {
     auto p1 = rotatedPoint(str2point(json["p1"].toString()), r, sz);
     auto p2 = rotatedPoint(str2point(json["p2"].toString()), r, sz);
@@ -286,8 +306,8 @@ QRectF GraphicsItem::boundingRect() const {
 }
 
 QJsonObject GraphicsItem::toJson() const {
-  auto parent = dynamic_cast<QGraphicsPixmapItem*>(parentItem());
-  auto sz = parent->pixmap().size();
+  auto parent = dynamic_cast<TiledImageItem*>(parentItem());
+  auto sz = parent->size();
 
   QJsonObject json;
   if (type_ == Type::Line) {
@@ -395,7 +415,7 @@ QJsonObject GraphicsItem::toJson() const {
       }
     }
 
-    json["type"] = "poly";
+    json["type"] = "smart_curve";
     json["count"] = points.size();
     for (int k = 0; k < points.size(); ++k) {
       json["p" + QString::number(k)] = point2str(rotatedPoint(points[k], rotation, sz, false));
@@ -1064,27 +1084,10 @@ void GraphicsItem::calcParameters(const cv::Mat& image) {
   }
   else if (type_ == Type::Poly) {
     auto poly = poly_->polygon();
-    auto rect = poly.boundingRect();
     int sum = 0, count = 0, max = 0, min = INT_MAX;
-    int left = qMax<int>(0, qMin(rect.x(), rect.x() + rect.width()));
-    int bottom = qMax<int>(0, qMin(rect.y(), rect.y() + rect.height()));
-    int right = qMin(left + qAbs<int>(rect.width()), image.cols - 1), top = qMin<int>(bottom + qAbs(rect.height()), image.rows - 1);
-    for (int i = left; i <= right; ++i) {
-      for (int j = bottom; j <= top; ++j) {
-        if (poly.containsPoint(QPointF(i, j), Qt::FillRule::OddEvenFill)) {
-          auto px = image.at<cv::Vec2b>(j, i);
-          min = qMin<int>(px[0], min);
-          max = qMax<int>(px[0], max);
-          sum += px[0];
-          count += 1;
-        }
-      }
-    }
+    spanStats(image, poly, sum, count, min, max);
 
-    int p = dist(poly.first(), poly.back());
-    for (int k = 0; k < poly.size() - 1; ++k) {
-      p += dist(poly[k], poly[k + 1]);
-    }
+    int p = perimeter(poly);
 
     min_ = min;
     max_ = max;
@@ -1094,22 +1097,8 @@ void GraphicsItem::calcParameters(const cv::Mat& image) {
   }
   else if (type_ == Type::SmartCurve) {
     auto poly = QPolygonF(smart_curve_->points());
-    auto rect = poly.boundingRect();
     int sum = 0, count = 0, max = 0, min = INT_MAX;
-    int left = qMax<int>(0, qMin(rect.x(), rect.x() + rect.width()));
-    int bottom = qMax<int>(0, qMin(rect.y(), rect.y() + rect.height()));
-    int right = qMin(left + qAbs<int>(rect.width()), image.cols - 1), top = qMin<int>(bottom + qAbs(rect.height()), image.rows - 1);
-    for (int i = left; i <= right; ++i) {
-      for (int j = bottom; j <= top; ++j) {
-        if (poly.containsPoint(QPointF(i, j), Qt::FillRule::OddEvenFill)) {
-          auto px = image.at<cv::Vec2b>(j, i);
-          min = qMin<int>(px[0], min);
-          max = qMax<int>(px[0], max);
-          sum += px[0];
-          count += 1;
-        }
-      }
-    }
+    spanStats(image, poly, sum, count, min, max);
 
     min_ = min;
     max_ = max;
@@ -1,5 +1,5 @@
 #pragma once
-#include <QGraphicsPixmapItem>
+#include <QGraphicsItem>
 #include <QJsonObject>
 #include <optional>
 
@@ -10,6 +10,7 @@
 #include "graphics_cobb_angle_item.h"
 #include "graphics_angle_item.h"
 #include "graphics_poly_item.h"
+#include "tiled_image_item.h"
 #include "smart_curve_item.h"
 #include <opencv2/opencv.hpp>
 
@@ -55,14 +56,14 @@ public:
   int rotation = 0;
 
 public:
-  static GraphicsItem* makeLine(const QPointF& p1, const QPointF& p2, QGraphicsPixmapItem* parent);
-  static GraphicsItem* makeEllipse(const QPointF& p1, const QPointF& p2, QGraphicsPixmapItem* parent);
-  static GraphicsItem* makeCobbAngle(const QPointF& pt, QGraphicsPixmapItem* parent);
-  static GraphicsItem* makeAngle(const QPointF& pt, QGraphicsPixmapItem* parent);
-  static GraphicsItem* makePoly(const QPointF& pt, QGraphicsPixmapItem* parent);
-  static GraphicsItem* makeSmartCurve(const QPointF& pt, QGraphicsPixmapItem* parent);
-
-  static GraphicsItem* makeFromJson(const QJsonObject& data, const QVector<Transformation>& t, int r, QGraphicsPixmapItem* parent);
+  static GraphicsItem* makeLine(const QPointF& p1, const QPointF& p2, TiledImageItem* parent);
+  static GraphicsItem* makeEllipse(const QPointF& p1, const QPointF& p2, TiledImageItem* parent);
+  static GraphicsItem* makeCobbAngle(const QPointF& pt, TiledImageItem* parent);
+  static GraphicsItem* makeAngle(const QPointF& pt, TiledImageItem* parent);
+  static GraphicsItem* makePoly(const QPointF& pt, TiledImageItem* parent);
+  static GraphicsItem* makeSmartCurve(const QPointF& pt, TiledImageItem* parent);
+
+  static GraphicsItem* makeFromJson(const QJsonObject& data, const QVector<Transformation>& t, int r, TiledImageItem* parent);
 
 public:
   GraphicsItem(QGraphicsItem* parent = nullptr);
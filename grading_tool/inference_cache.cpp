@@ -0,0 +1,199 @@
+#include "inference_cache.h"
+#include <QCryptographicHash>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QFile>
+#include <QSaveFile>
+
+InferenceCache::InferenceCache(const QString& dir, qint64 max_size) :
+  dir_(dir),
+  max_size_(max_size) {
+  dir_.mkpath(".");
+}
+
+void InferenceCache::setModelsKey(const QStringList& model_files, const QByteArray& settings) {
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  for (const auto& filename : model_files) {
+    QFile file(filename);
+    if (file.open(QIODevice::ReadOnly)) {
+      hash.addData(&file);
+    }
+    else {
+      hash.addData(filename.toUtf8());
+    }
+  }
+
+  hash.addData(settings);
+
+  QMutexLocker lock(&mutex_);
+  models_key_ = hash.result();
+}
+
+void InferenceCache::setMaxSize(qint64 max_size) {
+  QMutexLocker lock(&mutex_);
+  max_size_ = max_size;
+  evict();
+}
+
+QByteArray InferenceCache::imageHash(const cv::Mat& image) {
+  QCryptographicHash hash(QCryptographicHash::Sha1);
+  int header[] = { image.rows, image.cols, image.type() };
+  hash.addData(reinterpret_cast<const char*>(header), sizeof(header));
+
+  auto row_bytes = static_cast<int>(image.cols * image.elemSize());
+  for (int j = 0; j < image.rows; ++j) {
+    hash.addData(reinterpret_cast<const char*>(image.ptr(j)), row_bytes);
+  }
+
+  return hash.result().toHex();
+}
+
+QString InferenceCache::path(const QByteArray& key, const QString& ext) const {
+  return dir_.filePath(QString::fromLatin1(key) + ext);
+}
+
+QByteArray InferenceCache::jointsKey(const QByteArray& image_hash) const {
+  return QCryptographicHash::hash(image_hash + models_key_, QCryptographicHash::Sha1).toHex();
+}
+
+void InferenceCache::touch(const QString& filename) {
+  QFile file(filename);
+  if (file.open(QIODevice::ReadWrite)) {
+    file.setFileTime(QDateTime::currentDateTime(), QFileDevice::FileModificationTime);
+  }
+}
+
+void InferenceCache::evict() {
+  // newest first
+  auto entries = dir_.entryInfoList(QDir::Files, QDir::Time);
+
+  qint64 total = 0;
+  for (const auto& entry : entries) {
+    total += entry.size();
+    if (total > max_size_) {
+      QFile::remove(entry.absoluteFilePath());
+    }
+  }
+}
+
+bool InferenceCache::loadJoints(const QByteArray& image_hash, QVector<Metadata::Joint>& joints) {
+  QMutexLocker lock(&mutex_);
+
+  QFile file(path(jointsKey(image_hash), ".json"));
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  auto root = QJsonDocument::fromJson(file.readAll()).object();
+  file.close();
+
+  if (!root.contains("joints")) {
+    return false;
+  }
+
+  joints.clear();
+  for (const auto& it : root["joints"].toArray()) {
+    auto obj = it.toObject();
+    auto rect = obj["rect"].toArray();
+
+    Metadata::Joint joint;
+    joint.rect = cv::Rect(rect[0].toInt(), rect[1].toInt(), rect[2].toInt(), rect[3].toInt());
+    for (const auto& grade : obj["grades"].toArray()) {
+      auto g = grade.toObject();
+      joint.grades.push_back({ g["code"].toString(), static_cast<float>(g["confidence"].toDouble()) });
+    }
+
+    joints.push_back(joint);
+  }
+
+  touch(file.fileName());
+  return true;
+}
+
+void InferenceCache::storeJoints(const QByteArray& image_hash, const QVector<Metadata::Joint>& joints) {
+  QJsonArray items;
+  for (const auto& joint : joints) {
+    QJsonArray grades;
+    for (const auto& grade : joint.grades) {
+      grades.append(QJsonObject{ { "code", grade.mnemonic_code }, { "confidence", grade.confidence } });
+    }
+
+    QJsonArray rect = { joint.rect.x, joint.rect.y, joint.rect.width, joint.rect.height };
+    items.append(QJsonObject{ { "rect", rect }, { "grades", grades } });
+  }
+
+  QMutexLocker lock(&mutex_);
+
+  // written to a temporary file and renamed, so readers never see a partial entry
+  QSaveFile file(path(jointsKey(image_hash), ".json"));
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "can't write inference cache:" << file.fileName();
+    return;
+  }
+
+  file.write(QJsonDocument(QJsonObject{ { "joints", items } }).toJson(QJsonDocument::Compact));
+  if (!file.commit()) {
+    qWarning() << "can't write inference cache:" << file.fileName();
+  }
+
+  evict();
+}
+
+bool InferenceCache::loadGradient(const QByteArray& image_hash, cv::Mat& gradient) {
+  QMutexLocker lock(&mutex_);
+
+  QFile file(path(image_hash, ".grad"));
+  if (!file.open(QIODevice::ReadOnly)) {
+    return false;
+  }
+
+  qint32 rows = 0, cols = 0, type = 0;
+  QDataStream stream(&file);
+  stream >> rows >> cols >> type;
+
+  // header is checked before allocation, broken or foreign entries are removed
+  const qint64 header_size = 3 * sizeof(qint32);
+  auto bytes = qint64(rows) * cols * sizeof(float);
+  if (stream.status() != QDataStream::Ok || rows <= 0 || cols <= 0 || type != CV_32F || file.size() != header_size + bytes) {
+    file.remove();
+    return false;
+  }
+
+  cv::Mat dst(rows, cols, type);
+  if (stream.readRawData(reinterpret_cast<char*>(dst.data), static_cast<int>(bytes)) != bytes) {
+    file.remove();
+    return false;
+  }
+
+  file.close();
+  touch(file.fileName());
+
+  gradient = dst;
+  return true;
+}
+
+void InferenceCache::storeGradient(const QByteArray& image_hash, const cv::Mat& gradient) {
+  cv::Mat src = gradient.isContinuous() ? gradient : gradient.clone();
+
+  QMutexLocker lock(&mutex_);
+
+  // written to a temporary file and renamed, so loadGradient never sees a partial entry
+  QSaveFile file(path(image_hash, ".grad"));
+  if (!file.open(QIODevice::WriteOnly)) {
+    qWarning() << "can't write inference cache:" << file.fileName();
+    return;
+  }
+
+  QDataStream stream(&file);
+  stream << qint32(src.rows) << qint32(src.cols) << qint32(src.type());
+  stream.writeRawData(reinterpret_cast<const char*>(src.data), static_cast<int>(src.total() * src.elemSize()));
+  if (!file.commit()) {
+    qWarning() << "can't write inference cache:" << file.fileName();
+  }
+
+  evict();
+}
@@ -0,0 +1,41 @@
+#pragma once
+#include <QDir>
+#include <QMutex>
+#include <QVector>
+#include <QByteArray>
+#include <QStringList>
+#include <opencv2/opencv.hpp>
+
+#include "metadata.h"
+
+// Persistent cache of detection/classification results (and GVF gradients).
+// Joints are keyed by image content hash + hash of the used models, gradients - by image hash only.
+// When the total size exceeds the limit, least recently used entries are removed.
+class InferenceCache {
+protected:
+  QDir dir_;
+  qint64 max_size_;
+  QByteArray models_key_;
+  QMutex mutex_;
+
+  QString path(const QByteArray& key, const QString& ext) const;
+  QByteArray jointsKey(const QByteArray& image_hash) const;
+  void touch(const QString& filename);
+  void evict();
+
+public:
+  InferenceCache(const QString& dir, qint64 max_size);
+
+  // models identity (content of classifier archive, detector graph, etc.)
+  // @param settings: options which change the results of the same models (e.g. detector resolution)
+  void setModelsKey(const QStringList& model_files, const QByteArray& settings = QByteArray());
+  void setMaxSize(qint64 max_size);
+
+  static QByteArray imageHash(const cv::Mat& image);
+
+  bool loadJoints(const QByteArray& image_hash, QVector<Metadata::Joint>& joints);
+  void storeJoints(const QByteArray& image_hash, const QVector<Metadata::Joint>& joints);
+
+  bool loadGradient(const QByteArray& image_hash, cv::Mat& gradient);
+  void storeGradient(const QByteArray& image_hash, const cv::Mat& gradient);
+};
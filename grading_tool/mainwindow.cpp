@@ -19,16 +19,24 @@
 #include <QMenuBar>
 #include <QLabel>
 #include <QDebug>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QStandardPaths>
+#include <QImageReader>
 
 #undef slots
 #include <torch/script.h>
 #define slots Q_SLOTS
 
 #include <stdexcept>
-#include <gdcm/gdcmImageReader.h>
 #include <main_processor.h>
+#include <dev_contours_finder.h>
+#include <border_contours_finder.h>
+#include <contour_metrics.h>
+#include <utility.h>
 
 #include "utils.h"
+#include "contour_geometry.h"
 #include "view_queue.h"
 #include "progress_indicator.h"
 #include "settings_window.h"
@@ -45,6 +53,71 @@ QAction* nameAction(QToolBar* bar, QAction* action, const char* name = nullptr)
   return action;
 }
 
+bool isDICOM(const QString& path) {
+  auto suffix = QFileInfo(path).suffix().toLower();
+  return suffix == "dcm" || suffix == "dicom";
+}
+
+// image of item with rotation and flips applied; the cached plane is reused while the image
+// stays the same, a new orientation is composed onto it with a single remap
+const cv::Mat& displayImage(Metadata& data) {
+  auto orientation = Orientation::of(data.rotation, data.transformations);
+
+  // always a new plane: the previous one may share data with image or be still used by the viewport
+  cv::Mat display;
+  if (data.display_image.empty() || data.display_source.data != data.image.data) {
+    applyOrientation(data.image, display, orientation);
+    data.display_image = display;
+    data.display_source = data.image;
+  }
+  else if (data.display_orientation != orientation) {
+    applyOrientation(data.display_image, display, orientation * data.display_orientation.inverse());
+    data.display_image = display;
+  }
+
+  data.display_orientation = orientation;
+  return data.display_image;
+}
+
+// smart curves of item's graphics items, densified to contours (coordinates of the source image)
+xr::contours_t annotatedContours(const QJsonArray& graphics_items) {
+  xr::contours_t ans;
+  for (auto value : graphics_items) {
+    auto json = value.toObject();
+    if (json["type"].toString() != "smart_curve") continue;
+
+    xr::points_t points;
+    for (int k = 0; k < json["count"].toInt(); ++k) {
+      auto pt = str2point(json["p" + QString::number(k)].toString()).toPoint();
+      points.emplace_back(pt.x(), pt.y());
+    }
+
+    if (points.size() < 2) continue;
+
+    // curve is closed, neighbour points are joined by straight segments
+    xr::contour_t contour;
+    for (size_t k = 0; k < points.size(); ++k) {
+      auto path = xr::makeDirectPath(points[k], points[(k + 1) % points.size()]);
+      contour.insert(contour.end(), path.begin(), path.end());
+    }
+
+    ans.push_back(std::move(contour));
+  }
+
+  return ans;
+}
+
+// memory of the decoded 8-bit plane, known before decoding: dimensions from the header of
+// common formats, otherwise the file size (DICOM stores at least a byte per pixel, unless compressed)
+qint64 estimateDecodedBytes(const QString& path) {
+  if (!isDICOM(path)) {
+    auto size = QImageReader(path).size();
+    if (size.isValid()) return qint64(size.width()) * size.height();
+  }
+
+  return QFileInfo(path).size();
+}
+
 const std::tuple<QString, QColor, cv::Scalar> joint_colors[] = {
   { QString("Red Area"), QColor(Qt::red), cv::Scalar(200, 0, 0) },
   { QString("Blue Area"), QColor(Qt::blue), cv::Scalar(0, 0, 200) },
@@ -67,9 +140,16 @@ MainWindow::MainWindow(QWidget* parent) :
   loading_area_(new QWidget()),
   working_area_(new QWidget()),
   calib_coef_(new QLabel()),
+  ingest_status_(new QLabel()),
   loading_ind_(new ProgressIndicator()),
   right_panel_(new QTableWidget()),
-  view_queue_(new ViewQueue()) {
+  view_queue_(new ViewQueue()),
+  pipeline_(new Pipeline(this)),
+  processor_pool_(0),
+  inference_cache_(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/inference",
+    AppPrefs::read("inference_cache_size_mb", 512).toLongLong() * 1024 * 1024),
+  memory_(QStandardPaths::writableLocation(QStandardPaths::CacheLocation) + "/spill",
+    AppPrefs::read("memory_budget_mb", 2048).toLongLong() * 1024 * 1024) {
   setWindowTitle("Osteoarthritis Grading Tool");
 
   auto splitter = new QSplitter();
@@ -100,6 +180,9 @@ MainWindow::MainWindow(QWidget* parent) :
   l->addWidget(loading_ind_, 0, Qt::AlignLeft);
   l->addWidget(calib_coef_, 0, Qt::AlignLeft);
 
+  ingest_status_->setStyleSheet("background-color: black; color:white");
+  l->addWidget(ingest_status_, 0, Qt::AlignLeft);
+
   layout->addWidget(working_area_);
 
   // graphs area
@@ -132,9 +215,16 @@ MainWindow::MainWindow(QWidget* parent) :
 
   qRegisterMetaType<xr::contours_t>("xr::contours_t");
 
-  connect(this, &MainWindow::itemProcessed, this, &MainWindow::onItemProcessed, Qt::QueuedConnection);
+  connect(pipeline_, &Pipeline::itemProcessed, this, &MainWindow::onItemProcessed, Qt::QueuedConnection);
+  connect(pipeline_, &Pipeline::stageFinished, this, &MainWindow::onStageFinished, Qt::QueuedConnection);
+  connect(pipeline_, &Pipeline::idle, this, [this]() {
+    submitUnclassified();
+    if (pipeline_->isIdle()) loading_ind_->stopAnimation();
+  }, Qt::QueuedConnection);
   connect(this, &MainWindow::contoursFound, this, &MainWindow::onContoursFound, Qt::QueuedConnection);
   connect(this, &MainWindow::contoursFoundBase, this, &MainWindow::onContoursFoundBase, Qt::QueuedConnection);
+  connect(this, &MainWindow::detectorEvaluated, this, &MainWindow::onDetectorEvaluated, Qt::QueuedConnection);
+  connect(this, &MainWindow::contoursEvaluated, this, &MainWindow::onContoursEvaluated, Qt::QueuedConnection);
   connect(viewport_, &Viewport::calibFinished, this, &MainWindow::calibrateForLength);
   connect(viewport_, &Viewport::mousePosChanged, this, &MainWindow::mousePosChanged);
   connect(viewport_, &Viewport::mousePosOutOfImage, this, &MainWindow::mousePosOutOfImage);
@@ -168,9 +258,15 @@ MainWindow::MainWindow(QWidget* parent) :
 
   setCentralWidget(splitter);
   resize(800, 600);
+
+  initPipeline();
 }
 
 MainWindow::~MainWindow() {
+  // workers use models and cache of the window
+  decode_budget_.close();
+  pipeline_->stop();
+
   AppPrefs::write("window/position", this->pos());
   AppPrefs::write("window/size", this->size());
 }
@@ -200,6 +296,21 @@ void MainWindow::makeMenuTools() {
 
   auto open_sample = menu->addAction("Options...");
   connect(open_sample, &QAction::triggered, this, &MainWindow::showSettings);
+
+  auto evaluate_detector = menu->addAction("Evaluate detector resolution");
+  connect(evaluate_detector, &QAction::triggered, this, &MainWindow::evaluateDetector);
+
+  auto evaluate_contours = menu->addAction("Evaluate contours");
+  connect(evaluate_contours, &QAction::triggered, this, &MainWindow::evaluateContours);
+
+  auto save_baseline = menu->addAction("Save contours as baseline...");
+  connect(save_baseline, &QAction::triggered, this, &MainWindow::saveContoursBaseline);
+
+  auto compare_baseline = menu->addAction("Compare contours with baseline...");
+  connect(compare_baseline, &QAction::triggered, this, &MainWindow::compareContoursBaseline);
+
+  auto compare_finders = menu->addAction("Compare contours finders");
+  connect(compare_finders, &QAction::triggered, this, &MainWindow::compareFinders);
 }
 
 void MainWindow::makeMenuMeasure() {
@@ -316,6 +427,7 @@ void MainWindow::showTransformMenu() {
       current_item_->transformations.push_back(Transformation::HFlip);
     }
 
+    ++current_item_->revision;
     saveCurrentGraphicsItems();
     updateCurrentItem();
     clearModeView();
@@ -330,6 +442,7 @@ void MainWindow::showTransformMenu() {
       current_item_->transformations.push_back(Transformation::VFlip);
     }
 
+    ++current_item_->revision;
     saveCurrentGraphicsItems();
     updateCurrentItem();
     clearModeView();
@@ -341,6 +454,7 @@ void MainWindow::showTransformMenu() {
       saveCurrentGraphicsItems();
       current_item_->transformations.clear();
       current_item_->rotation = 0;
+      ++current_item_->revision;
       updateCurrentItem();
     }
   });
@@ -363,17 +477,16 @@ void MainWindow::showProcMenu() {
 
   auto none = new QAction("None", menu);
   connect(none, &QAction::triggered, [this]() {
-    current_item_->image = current_item_->src_image.clone();
-    updateCurrentItem();
+    current_item_->image = current_item_->src_image;
+    ++current_item_->revision;
+    updateCurrentItem(UpdateImage);
   });
 
   auto inv = new QAction("Invert", menu);
   connect(inv, &QAction::triggered, [this]() {
-    cv::Mat tmp;
-    cv::cvtColor(current_item_->src_image, tmp, cv::COLOR_RGB2GRAY);
-    tmp = 255 - tmp;
-    cv::cvtColor(tmp, current_item_->image, cv::COLOR_GRAY2RGB);
-    updateCurrentItem();
+    current_item_->image = 255 - current_item_->src_image;
+    ++current_item_->revision;
+    updateCurrentItem(UpdateImage);
   });
 
   auto sharpen_1 = new QAction("Sharpen 1", menu);
@@ -402,7 +515,8 @@ void MainWindow::showProcMenu() {
       cv::Mat sharpened = current_item_->image * (1 + amount) + blurred * (-amount);
       current_item_->image.copyTo(sharpened, lowContrastMask);
       current_item_->image = sharpened;
-      updateCurrentItem();
+      ++current_item_->revision;
+      updateCurrentItem(UpdateImage);
     }
   });
 
@@ -587,10 +701,137 @@ void MainWindow::init() {
   initClassifier();
 }
 
+void MainWindow::initPipeline() {
+  pipeline_->addStage("decode", 1, [this](Pipeline::Job& job) { decodeStage(job); });
+  auto detect_batch = AppPrefs::read("pipeline/detect_batch", 4).toInt();
+  pipeline_->addBatchStage("detect", 1, [this](std::vector<Pipeline::Job>& jobs) { detectStage(jobs); }, detect_batch);
+  pipeline_->addStage("crop", 1, [this](Pipeline::Job& job) { cropStage(job); });
+  pipeline_->addStage("classify", 1, [this](Pipeline::Job& job) { classifyStage(job); });
+  pipeline_->addStage("gradient", 1, [this](Pipeline::Job& job) { gradientStage(job); });
+}
+
 void MainWindow::initClassifier() {
+  // budgets and DICOM window are applied live
+  auto decode_budget = AppPrefs::read("decode_memory_budget_mb", 1024).toLongLong() * 1024 * 1024;
+  decode_budget_.setLimit(decode_budget);
+  memory_.setBudget(AppPrefs::read("memory_budget_mb", 2048).toLongLong() * 1024 * 1024);
+  {
+    QMutexLocker lock(&dicom_mutex_);
+    dicom_options_.auto_window = AppPrefs::read("dicom_auto_window", false).toBool();
+    dicom_options_.percentile = AppPrefs::read("dicom_window_percentile", 0.5).toDouble();
+  }
+
+  // models, threads and stages to run are changed only with stopped workers
+  auto cores = QThread::idealThreadCount();
+  QVariantList config = {
+    AppPrefs::read("enable_classifier"),
+    AppPrefs::read("precompute_gradient", false),
+    AppPrefs::read("classifier_params_path"),
+    AppPrefs::read("inference_threads", cores),
+    AppPrefs::read("detector_threads", cores),
+    AppPrefs::read("detector_input_size", 1024),
+    AppPrefs::read("pipeline/decode_workers", qMax(1, cores / 2)),
+    AppPrefs::read("pipeline/detect_workers", 1),
+    AppPrefs::read("pipeline/crop_workers", 1),
+    AppPrefs::read("pipeline/classify_workers", 1),
+    AppPrefs::read("pipeline/gradient_workers", qMax(1, cores / 4))
+  };
+
+  if (config == pipeline_config_) {
+    return;
+  }
+
+  pipeline_config_ = config;
+
+  // queued and unfinished items are submitted again after the restart
+  decode_budget_.close();
+  auto dropped = pipeline_->stop();
+  decode_budget_.open();
+
   classifier_enabled_ = AppPrefs::read("enable_classifier").toBool();
+  precompute_gradient_ = AppPrefs::read("precompute_gradient", false).toBool();
+
+  // all joints go through one forward pass, so let libtorch use all cores for it
+  auto intra_op = AppPrefs::read("inference_threads", QThread::idealThreadCount()).toInt();
+  Classifier::setNumThreads(intra_op, 1);
+
   classifier_.initFromResource(AppPrefs::read("classifier_params_path").toString());
+
+  // detector is created on the first use with new threads settings
+  {
+    QMutexLocker lock(&detector_mutex_);
+    detector_config_.intra_op_threads = AppPrefs::read("detector_threads", QThread::idealThreadCount()).toInt();
+    detector_config_.inter_op_threads = 1;
+    detector_input_size_ = AppPrefs::read("detector_input_size", 1024).toInt();
+    detector_.reset();
+  }
+
+  // joints depend on the detector resolution too
+  inference_cache_.setModelsKey({ AppPrefs::read("classifier_params_path").toString(), detector_graph_file_ },
+    "detector_input_size=" + QByteArray::number(detector_input_size_));
   right_panel_->setVisible(classifier_enabled_);
+
+  // workers of the pipeline stages
+  pipeline_->setWorkers("decode", AppPrefs::read("pipeline/decode_workers", qMax(1, cores / 2)).toInt());
+  pipeline_->setWorkers("detect", AppPrefs::read("pipeline/detect_workers", 1).toInt());
+  pipeline_->setWorkers("crop", AppPrefs::read("pipeline/crop_workers", 1).toInt());
+  pipeline_->setWorkers("classify", AppPrefs::read("pipeline/classify_workers", 1).toInt());
+  pipeline_->setWorkers("gradient", AppPrefs::read("pipeline/gradient_workers", qMax(1, cores / 4)).toInt());
+  pipeline_->start();
+  resubmit(dropped);
+}
+
+void MainWindow::resubmit(const QList<Metadata::HardPtr>& dropped) {
+  // items in process are pinned, so their images are still in memory;
+  // not decoded files go to the decoder again, they are still counted by ingest status
+  for (auto& item : dropped) {
+    if (!item->src_image.empty()) {
+      pipeline_->submit(item, "detect");
+    }
+    else if (!item->path.isEmpty()) {
+      pipeline_->submit(item, "decode");
+    }
+  }
+
+  unclassified_.clear();
+  if (classifier_enabled_) {
+    for (auto& item : view_queue_->items()) {
+      if (item->classified || pipeline_->contains(item.get())) continue;
+
+      if (item->src_image.empty()) unclassified_.push_back(item);
+      else pipeline_->submit(item, "detect");
+    }
+  }
+
+  submitUnclassified();
+  if (!pipeline_->isIdle()) {
+    loading_ind_->startAnimation();
+  }
+}
+
+void MainWindow::submitUnclassified() {
+  if (!pipeline_->isIdle()) {
+    return;
+  }
+
+  auto batch = qMax(1, AppPrefs::read("pipeline/detect_batch", 4).toInt());
+  while (batch > 0 && !unclassified_.isEmpty()) {
+    auto item = unclassified_.takeFirst();
+    if (!classifier_enabled_ || item->classified || pipeline_->contains(item.get())) continue;
+
+    memory_.touch(item);
+    pipeline_->submit(item, "detect");
+    --batch;
+  }
+
+  if (!pipeline_->isIdle()) {
+    loading_ind_->startAnimation();
+  }
+}
+
+DicomOptions MainWindow::dicomOptions() {
+  QMutexLocker lock(&dicom_mutex_);
+  return dicom_options_;
 }
 
 void MainWindow::setItemAsCurrent(Metadata::HardPtr data) {
@@ -602,39 +843,49 @@ void MainWindow::setItemAsCurrent(Metadata::HardPtr data) {
   }
 
   current_item_ = data;
+  memory_.touch(data);
   updateCurrentItem();
+  shrinkMemory();
 
-  // run classification if needed
-  if (classifier_enabled_ && data->joints.isEmpty() && !in_process_.contains(data.get())) {
-    if (!in_process_.isEmpty()) {
-      process_queue_.push_back(data);
-    }
-    else {
-      in_process_.insert(data.get());
-      loading_ind_->startAnimation();
-
-      QtConcurrent::run(this, &MainWindow::runOnData, data);
-    }
+  // run classification if needed, selected item goes ahead of the others
+  if (classifier_enabled_ && !data->classified && !pipeline_->contains(data.get())) {
+    loading_ind_->startAnimation();
+    pipeline_->submit(data, "detect", true);
   }
 }
 
-void MainWindow::onItemProcessed(Metadata::HardPtr data) {
-  if (!process_queue_.isEmpty()) {
-    auto next = process_queue_.takeFirst();
-    in_process_.insert(next.get());
-
-    QtConcurrent::run(this, &MainWindow::runOnData, next);
+void MainWindow::onStageFinished(Metadata::HardPtr data, const QString& stage) {
+  if (stage != "decode" || data->path.isEmpty()) {
+    return;
   }
-  else if (in_process_.isEmpty()) {
-    loading_ind_->stopAnimation();
+
+  decode_budget_.release(data->decode_budget);
+  data->decode_budget = 0;
+
+  ++ingest_done_;
+  ingest_bytes_ += QFileInfo(data->path).size();
+  updateIngestStatus();
+
+  if (!data->src_image.empty()) {
+    addItem(data);
   }
+}
 
+void MainWindow::updateIngestStatus() {
+  auto secs = qMax<qint64>(1, ingest_timer_.elapsed()) / 1000.0;
+  ingest_status_->setText(QString("%1/%2 files, %3 files/s, %4 MB/s")
+    .arg(ingest_done_)
+    .arg(ingest_total_)
+    .arg(ingest_done_ / secs, 0, 'f', 1)
+    .arg(ingest_bytes_ / (1024.0 * 1024.0) / secs, 0, 'f', 1));
+}
+
+void MainWindow::onItemProcessed(Metadata::HardPtr data) {
+  shrinkMemory();
+
+  // image and graphics items are unchanged, only results of processing are shown
   if (current_item_ == data) {
-    viewport_->setJoints(current_item_->joints, current_item_->transformations, current_item_->rotation);
-    current_item_->viewport_state = viewport_->state();
-    current_item_->calib_coef = viewport_->calibCoef();
-    current_item_->graphics_items = viewport_->graphicsItems();
-    updateCurrentItem();
+    updateCurrentItem(UpdateJoints);
   }
 }
 
@@ -702,114 +953,233 @@ void MainWindow::saveCurrentGraphicsItems() {
   }
 }
 
-void MainWindow::updateCurrentItem() {
-  auto sample = current_item_->image.clone();
-
-  // remove previous graphs
-  right_panel_->setRowCount(0);
-  right_panel_->setRowCount(current_item_->joints.size());
-  for (int k = 0; k < current_item_->joints.size(); ++k) {
-    const auto& joint = current_item_->joints[k];
-
-    // calc maximum
-    int grade_idx = 0;
-    for (int i = 1; i < joint.grades.size(); ++i) {
-      if (joint.grades[i].confidence > joint.grades[grade_idx].confidence) {
-        grade_idx = i;
+void MainWindow::updateCurrentItem(int what) {
+  if (what & UpdateJoints) {
+    // remove previous graphs
+    right_panel_->setRowCount(0);
+    right_panel_->setRowCount(current_item_->joints.size());
+    for (int k = 0; k < current_item_->joints.size(); ++k) {
+      const auto& joint = current_item_->joints[k];
+
+      // calc maximum
+      int grade_idx = 0;
+      for (int i = 1; i < joint.grades.size(); ++i) {
+        if (joint.grades[i].confidence > joint.grades[grade_idx].confidence) {
+          grade_idx = i;
+        }
       }
-    }
 
-    // create graph
-    auto conf = joint.grades[grade_idx].confidence;
-    auto grade = joint.grades[grade_idx].mnemonic_code;
-    auto title = QString("Grade %1, %2").arg(grade).arg(conf);
+      // create graph
+      auto conf = joint.grades[grade_idx].confidence;
+      auto grade = joint.grades[grade_idx].mnemonic_code;
+      auto title = QString("Grade %1, %2").arg(grade).arg(conf);
 
-    auto graph = makeGraph(title, std::get<1>(joint_colors[k % 2]), joint.grades);
-    right_panel_->setCellWidget(k, 0, graph);
+      auto graph = makeGraph(title, std::get<1>(joint_colors[k % 2]), joint.grades);
+      right_panel_->setCellWidget(k, 0, graph);
+    }
   }
 
-  // transformations
-  if (const auto r = current_item_->rotation) {
-    if (r == 90) cv::rotate(sample, sample, cv::ROTATE_90_CLOCKWISE);
-    else if (r == 270) cv::rotate(sample, sample, cv::ROTATE_90_COUNTERCLOCKWISE);
-    else if (r == 180) cv::rotate(sample, sample, cv::ROTATE_180);
+  // current item, rotation and flips are taken from the item's render cache
+  if (what & UpdateImage) {
+    viewport_->setImage(displayImage(*current_item_), current_item_->rotation);
   }
 
-  for (auto t : current_item_->transformations) {
-    if (t == Transformation::HFlip) cv::flip(sample, sample, 1);
-    else if (t == Transformation::VFlip) cv::flip(sample, sample, 0);
-    else {
-      // TODO:
-    }
+  if (what & (UpdateJoints | UpdateGraphics)) {
+    viewport_->setJoints(current_item_->joints, current_item_->transformations, current_item_->rotation);
   }
 
-  // currentn item
-  viewport_->setImage(sample, current_item_->rotation);
-  viewport_->setJoints(current_item_->joints, current_item_->transformations, current_item_->rotation);
   viewport_->setGradient(current_item_->gradient);
-  if (in_process_.isEmpty()) {
+  if (pipeline_->isIdle()) {
     loading_ind_->stopAnimation();
   }
 
-  // set actual image position and scale
-  if (!current_item_->already_display) {
-    viewport_->fitImageToViewport();
-    current_item_->viewport_state = viewport_->state();
-    current_item_->already_display = true;
-  }
-  else {
-    viewport_->setState(current_item_->viewport_state);
-  }
+  if (what & UpdateGraphics) {
+    // set actual image position and scale
+    if (!current_item_->already_display) {
+      viewport_->fitImageToViewport();
+      current_item_->viewport_state = viewport_->state();
+      current_item_->already_display = true;
+    }
+    else {
+      viewport_->setState(current_item_->viewport_state);
+    }
 
-  // restore graphics items
-  viewport_->setCalibrationCoef(current_item_->calib_coef);
-  viewport_->setGraphicsItems(current_item_->graphics_items, current_item_->transformations, current_item_->rotation);
-  calib_coef_->setText(current_item_->calib_coef ? QString::number(current_item_->calib_coef.value()) : "");
+    // restore graphics items
+    viewport_->setCalibrationCoef(current_item_->calib_coef);
+    viewport_->setGraphicsItems(current_item_->graphics_items, current_item_->transformations, current_item_->rotation);
+    calib_coef_->setText(current_item_->calib_coef ? QString::number(current_item_->calib_coef.value()) : "");
+  }
 
   view_queue_->updateView();
   zoom_menu_->setEnabled(true);
 }
 
-void MainWindow::runOnData(Metadata::HardPtr data) {
-  auto sample = data->src_image.clone();
+void MainWindow::decodeStage(Pipeline::Job& job) {
+  auto data = job.data;
+  if (data->src_image.empty() && !data->path.isEmpty()) {
+    // decoded images wait for UI within the memory budget, so it's taken before decoding;
+    // the budget is closed only while the pipeline is restarted, then the image is decoded
+    // without it and the item is resubmitted
+    auto bytes = estimateDecodedBytes(data->path);
+    data->decode_budget = decode_budget_.acquire(bytes) ? bytes : 0;
+
+    if (isDICOM(data->path)) data->src_image = readDICOM(data->path, dicomOptions());
+    else data->src_image = cv::imread(data->path.toLocal8Bit().data(), cv::IMREAD_GRAYSCALE);
+    data->image = data->src_image;
+  }
+
+  if (data->src_image.empty()) {
+    throw std::runtime_error("Can't decode image " + data->path.toStdString());
+  }
 
-  // detect joints
-  std::vector<cv::Rect> joints;
-  try {
-    joints = runDetector(sample);
+  // without classifier nothing to do until contours search
+  job.done = !classifier_enabled_ && !precompute_gradient_;
+}
+
+void MainWindow::detectStage(std::vector<Pipeline::Job>& jobs) {
+  std::vector<Pipeline::Job*> pending;
+  std::vector<cv::Mat> images;
+  std::vector<cv::Size> sizes;
+  for (auto& job : jobs) {
+    auto data = job.data;
+    if (!classifier_enabled_ || data->classified) {
+      job.done = !precompute_gradient_;
+      continue;
+    }
+
+    if (data->content_hash.isEmpty()) {
+      data->content_hash = InferenceCache::imageHash(data->src_image);
+    }
+
+    // results of the previous sessions
+    if (inference_cache_.loadJoints(data->content_hash, data->joints)) {
+      data->classified = true;
+      job.done = !precompute_gradient_;
+      continue;
+    }
+
+    if (data->detection_image.empty()) {
+      data->detection_image = detectorInput(data->src_image);
+    }
+
+    pending.push_back(&job);
+    images.push_back(data->detection_image);
+    sizes.push_back(data->src_image.size());
   }
-  catch (const std::exception& e) {
-    in_process_.remove(data.get());
-    emit itemProcessed(data);
-    qWarning() << e.what();
+
+  if (images.empty()) {
     return;
   }
 
-  // classification
-  for (auto rect : joints) {
-    auto grades = runClassifier(sample(rect));
+  // images of the same size go through the detector in one run
+  auto all_joints = runDetector(images, sizes);
+  for (size_t i = 0; i < pending.size(); ++i) {
+    pending[i]->joints = all_joints[i];
+  }
+}
+
+void MainWindow::cropStage(Pipeline::Job& job) {
+  auto sample = job.data->src_image;
+  job.crops.resize(job.joints.size());
+  for (size_t i = 0; i < job.joints.size(); ++i) {
+    // classifier takes RGB frames, only small crops are expanded to 3 channels
+    cv::Mat crop;
+    cv::resize(sample(job.joints[i]), crop, classifier_.getFrameSize());
+    cv::cvtColor(crop, job.crops[i], cv::COLOR_GRAY2RGB);
+  }
+}
+
+void MainWindow::classifyStage(Pipeline::Job& job) {
+  auto data = job.data;
+  if (!classifier_enabled_ || data->classified) { // already classified or loaded from the cache
+    return;
+  }
 
+  // all joints in one batch; no joints found is a result too, it's cached as well
+  QVector<QVector<Classifier::Item>> all_grades;
+  if (!job.crops.empty()) {
+    all_grades = classifier_.getGrades(job.crops);
+  }
+
+  for (const auto& grades : all_grades) {
+    qDebug() << "";
+    for (auto grade : grades) {
+      qDebug() << grade.mnemonic_code << grade.confidence;
+    }
+  }
+
+  QVector<Metadata::Joint> joints;
+  for (size_t i = 0; i < job.joints.size(); ++i) {
     Metadata::Joint joint;
-    joint.grades = grades;
-    joint.rect = rect;
-    data->joints.push_back(joint);
+    joint.grades = all_grades[static_cast<int>(i)];
+    joint.rect = job.joints[i];
+    joints.push_back(joint);
   }
 
-  in_process_.remove(data.get());
-  emit itemProcessed(data);
+  data->joints = joints;
+  data->classified = true;
+  inference_cache_.storeJoints(data->content_hash, data->joints);
 }
 
-void MainWindow::findContoursOnData(Metadata::HardPtr data) {
-  auto sample = data->image.clone();
+void MainWindow::gradientStage(Pipeline::Job& job) {
+  // GVF for the contours search, it's expensive, so only on demand
+  if (precompute_gradient_) {
+    prepareGradient(job.data);
+  }
+}
 
-  // make gradient for current image
-  if (data->gradient.empty()) {
+void MainWindow::prepareGradient(Metadata::HardPtr data) {
+  if (!data->gradient.empty()) {
+    return;
+  }
+
+  if (data->content_hash.isEmpty()) {
+    data->content_hash = InferenceCache::imageHash(data->src_image);
+  }
+
+  cv::Mat gradient;
+  if (!inference_cache_.loadGradient(data->content_hash, gradient)) {
     cv::Mat temp;
     cv::GaussianBlur(data->src_image, temp, cv::Size(3, 3), 0, 0, cv::BORDER_DEFAULT);
-    cv::cvtColor(temp, temp, cv::COLOR_RGB2GRAY);
-    data->gradient = gvf(temp, 0.04, 55);
+    gvf(temp, 0.04, 55).convertTo(gradient, CV_32F);
+
+    inference_cache_.storeGradient(data->content_hash, gradient);
   }
 
+  // half of the memory of double plane, path finder converts it on use
+  if (gradient.type() != CV_32F) gradient.convertTo(gradient, CV_32F);
+  data->gradient = gradient;
+}
+
+xr::ProcessorPool::Processor MainWindow::acquireProcessor() {
+  int flags = 0;
+  if (AppPrefs::read("image_smoothing").toBool()) flags |= xr::MainProcessor::UseAutoBlur;
+  if (AppPrefs::read("use_openmp").toBool()) flags |= xr::MainProcessor::UseOpenMP;
+  if (AppPrefs::read("active_contours").toBool()) flags |= xr::MainProcessor::UseActiveContours;
+  if (AppPrefs::read("accurate_split").toBool()) flags |= xr::MainProcessor::UseAccurateSplit;
+
+  auto processor = processor_pool_.acquire();
+  processor->setFlags(flags);
+
+  auto edge_detector = AppPrefs::read("edge_detector", "kirsch").toString();
+  if (edge_detector == "kirsch") processor->setGradientOpType(xr::MainProcessor::GradientOpType::Kirsch);
+  else processor->setGradientOpType(xr::MainProcessor::GradientOpType::Sobel);
+
+  auto em = AppPrefs::read("extraction_method", "radial").toString();
+  if (em == "radial") processor->setContoursFinderType(xr::MainProcessor::FinderType::Radial);
+  else if (em == "rosenfeld") processor->setContoursFinderType(xr::MainProcessor::FinderType::Rosenfeld);
+  else if (em == "border") processor->setContoursFinderType(xr::MainProcessor::FinderType::Border);
+  else processor->setContoursFinderType(xr::MainProcessor::FinderType::Simple);
+
+  return processor;
+}
+
+void MainWindow::findContoursOnData(Metadata::HardPtr data) {
+  auto sample = data->image.clone();
+
+  // make gradient for current image
+  prepareGradient(data);
+
   // calc joints areas
   std::vector<cv::Rect> joints;
   if (!data->joints.isEmpty()) {
@@ -821,6 +1191,12 @@ void MainWindow::findContoursOnData(Metadata::HardPtr data) {
     joints = runDetector(sample);
   }
 
+  // one processor for all joints: its buffers are reused between crops
+  auto processor = acquireProcessor();
+
+  // contours of all joints are kept, the evaluation tools match annotations on every knee
+  data->contours.clear();
+
   // find contours for all extended areas
   for (auto rect : joints) {
     int x = qMax(1, rect.x - rect.width / 4);
@@ -848,33 +1224,16 @@ void MainWindow::findContoursOnData(Metadata::HardPtr data) {
     xr::Image dst(subsample.cols, subsample.rows);
     for (int i = 0; i < subsample.cols; ++i) {
       for (int j = 0; j < subsample.rows; ++j) {
-        auto rgb = subsample.at<cv::Vec3b>(j, i);
-        dst.byte(i, j) = (int(rgb[0]) + int(rgb[1]) + int(rgb[2])) / 3;
+        dst.byte(i, j) = subsample.at<uchar>(j, i);
       }
     }
 
-    int flags = 0;
-    if (AppPrefs::read("image_smoothing").toBool()) flags |= xr::MainProcessor::UseAutoBlur;
-    if (AppPrefs::read("use_openmp").toBool()) flags |= xr::MainProcessor::UseOpenMP;
-    if (AppPrefs::read("active_contours").toBool()) flags |= xr::MainProcessor::UseActiveContours;
-    if (AppPrefs::read("accurate_split").toBool()) flags |= xr::MainProcessor::UseAccurateSplit;
-
-    xr::MainProcessor processor(std::move(dst), flags);
-
-    auto edge_detector = AppPrefs::read("edge_detector", "kirsch").toString();
-    if (edge_detector == "kirsch") processor.setGradientOpType(xr::MainProcessor::GradientOpType::Kirsch);
-    else processor.setGradientOpType(xr::MainProcessor::GradientOpType::Sobel);
-
-    auto em = AppPrefs::read("extraction_method", "radial").toString();
-    if (em == "radial") processor.setContoursFinderType(xr::MainProcessor::FinderType::Radial);
-    else if (em == "rosenfeld") processor.setContoursFinderType(xr::MainProcessor::FinderType::Rosenfeld);
-    else processor.setContoursFinderType(xr::MainProcessor::FinderType::Simple);
-
     // run search
-    data->contours = processor.findContours();
+    processor->assign(std::move(dst));
+    auto contours = processor->findContours();
 
     // move contours to global coords system
-    for (auto& contour : data->contours) {
+    for (auto& contour : contours) {
       auto r = ::rect(contour);
       for (auto& pt : contour) {
         pt.x = rect.x + pt.x / factor;
@@ -883,8 +1242,10 @@ void MainWindow::findContoursOnData(Metadata::HardPtr data) {
     }
 
     QVector<QVector<QPoint>> simplified_contours;
-    if (!data->contours.empty()) {
-      for (auto contour : data->contours) {
+    if (!contours.empty()) {
+      // measures are computed once per contour, not in every comparison
+      std::vector<std::pair<ContourMeasures, QVector<QPoint>>> candidates;
+      for (const auto& contour : contours) {
         auto r = ::rect(contour);
 
 #if 0
@@ -895,8 +1256,8 @@ void MainWindow::findContoursOnData(Metadata::HardPtr data) {
 #endif
 
         // skip improbable big contours
-        auto j1 = jaccard(r, cv::Rect(0, 0, dst.width() / 2, dst.height()));
-        auto j2 = jaccard(r, cv::Rect(dst.width() / 2, 0, dst.width() / 2, dst.height()));
+        auto j1 = jaccard(r, cv::Rect(0, 0, subsample.cols / 2, subsample.rows));
+        auto j2 = jaccard(r, cv::Rect(subsample.cols / 2, 0, subsample.cols / 2, subsample.rows));
         if ((j1 > 0.1 && j2 < 0.05) || j2 > 0.1 && j1 < 0.05) {
           continue;
         }
@@ -909,21 +1270,24 @@ void MainWindow::findContoursOnData(Metadata::HardPtr data) {
           if (k++ % 20 == 0) points.push_back(QPoint(pt.x, pt.y));
         }
 
-        auto poly = QPolygonF(points);
-        if (square(poly) > perimeter(poly) * 2) {
-          simplified_contours.push_back(points);
+        auto m = measure(QPolygonF(points));
+        if (m.pixels > m.perimeter * 2) {
+          candidates.emplace_back(m, points);
         }
       }
 
-      // order by square
-      qSort(simplified_contours.begin(), simplified_contours.end(), [](auto lhs, auto rhs) {
-        return square(QPolygonF(lhs)) > square(QPolygonF(rhs));
+      // keep only 2 biggest contours (by number of pixels inside, as the filter above)
+      auto count = std::min<size_t>(2, candidates.size());
+      std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [](const auto& lhs, const auto& rhs) {
+        return lhs.first.pixels > rhs.first.pixels;
       });
 
-      // keep only 2 biggest contours
-      while (simplified_contours.size() > 2) simplified_contours.pop_back();
+      for (size_t k = 0; k < count; ++k) {
+        simplified_contours.push_back(candidates[k].second);
+      }
     }
 
+    data->contours.insert(data->contours.end(), std::make_move_iterator(contours.begin()), std::make_move_iterator(contours.end()));
     emit contoursFound(simplified_contours);
   }
 }
@@ -932,12 +1296,7 @@ void MainWindow::findContoursOnImageImpl(Metadata::HardPtr data) {
   auto subsample = data->image.clone();
 
   // make gradient for current image
-  if (data->gradient.empty()) {
-    cv::Mat temp;
-    cv::GaussianBlur(data->src_image, temp, cv::Size(3, 3), 0, 0, cv::BORDER_DEFAULT);
-    cv::cvtColor(temp, temp, cv::COLOR_RGB2GRAY);
-    data->gradient = gvf(temp, 0.04, 55);
-  }
+  prepareGradient(data);
 
   // resize image for contours search func
   const auto desired_image_size = 300;
@@ -955,34 +1314,14 @@ void MainWindow::findContoursOnImageImpl(Metadata::HardPtr data) {
   xr::Image dst(subsample.cols, subsample.rows);
   for (int i = 0; i < subsample.cols; ++i) {
     for (int j = 0; j < subsample.rows; ++j) {
-      auto rgb = subsample.at<cv::Vec3b>(j, i);
-
-      uint8_t r = rgb[0];
-      uint8_t g = rgb[1];
-      uint8_t b = rgb[2];
-      dst.byte(i, j) = static_cast<uint8_t>(r * 0.114 + g * 0.587 + b * 0.299);
+      dst.byte(i, j) = subsample.at<uchar>(j, i);
     }
   }
 
-  int flags = 0;
-  if (AppPrefs::read("image_smoothing").toBool()) flags |= xr::MainProcessor::UseAutoBlur;
-  if (AppPrefs::read("use_openmp").toBool()) flags |= xr::MainProcessor::UseOpenMP;
-  if (AppPrefs::read("active_contours").toBool()) flags |= xr::MainProcessor::UseActiveContours;
-  if (AppPrefs::read("accurate_split").toBool()) flags |= xr::MainProcessor::UseAccurateSplit;
-
-  xr::MainProcessor processor(std::move(dst), flags);
-
-  auto edge_detector = AppPrefs::read("edge_detector", "kirsch").toString();
-  if (edge_detector == "kirsch") processor.setGradientOpType(xr::MainProcessor::GradientOpType::Kirsch);
-  else processor.setGradientOpType(xr::MainProcessor::GradientOpType::Sobel);
-
-  auto em = AppPrefs::read("extraction_method", "radial").toString();
-  if (em == "radial") processor.setContoursFinderType(xr::MainProcessor::FinderType::Radial);
-  else if (em == "rosenfeld") processor.setContoursFinderType(xr::MainProcessor::FinderType::Rosenfeld);
-  else processor.setContoursFinderType(xr::MainProcessor::FinderType::Simple);
-
   // run search
-  data->contours = processor.findContours();
+  auto processor = acquireProcessor();
+  processor->assign(std::move(dst));
+  data->contours = processor->findContours();
 
   for (auto& contour : data->contours) {
     for (auto& pt : contour) {
@@ -1002,22 +1341,23 @@ void MainWindow::rotateCurrentItem(int angle) {
   if (current_item_->rotation < 0) current_item_->rotation += 360;
   else if (current_item_->rotation > 270) current_item_->rotation -= 360;
 
+  ++current_item_->revision;
   updateCurrentItem();
   clearModeView();
 }
 
 void MainWindow::applyFilterForCurrent(cv::Mat filter, float delta, bool apply_to_gray) {
   if (current_item_) {
-    cv::Mat tmp, output;
-    if (!apply_to_gray) tmp = current_item_->src_image;
-    else cv::cvtColor(current_item_->src_image, tmp, cv::COLOR_RGB2GRAY);
-
-    cv::filter2D(tmp, output, -1, filter, cv::Point(-1, -1), delta);
+    // source image is gray already
+    Q_UNUSED(apply_to_gray);
 
-    if (!apply_to_gray) current_item_->image = output;
-    else cv::cvtColor(output, current_item_->image, cv::COLOR_GRAY2RGB);
+    // new plane: image may share data with src_image
+    cv::Mat output;
+    cv::filter2D(current_item_->src_image, output, -1, filter, cv::Point(-1, -1), delta);
+    current_item_->image = output;
 
-    updateCurrentItem();
+    ++current_item_->revision;
+    updateCurrentItem(UpdateImage);
   }
 }
 
@@ -1025,44 +1365,359 @@ void MainWindow::calibrate(GraphicsItem* item, const QPoint& pt) {
   calibrateForLength(item->length());
 }
 
+cv::Mat MainWindow::detectorInput(const cv::Mat& image) const {
+  auto max_side = qMax(image.cols, image.rows);
+  if (detector_input_size_ <= 0 || max_side <= detector_input_size_) {
+    return image;
+  }
+
+  // detector resizes input anyway, so full resolution only costs time and memory
+  auto factor = detector_input_size_ * 1.0 / max_side;
+  cv::Mat ans;
+  cv::resize(image, ans, cv::Size(), factor, factor, cv::INTER_AREA);
+  return ans;
+}
+
 std::vector<cv::Rect> MainWindow::runDetector(const cv::Mat& sample) {
-  if (!detector_) { // init detector
-    if (QFile(detector_graph_file_).exists()) {
-      detector_ = tfdetect::CreateDetectorFromGraph("frozen_inference_graph.pb");
-    }
-    else {
-      throw std::runtime_error("Detector's frozen graph file not found! Skip...");
+  return runDetector({ detectorInput(sample) }, { sample.size() }).front();
+}
+
+std::vector<std::vector<cv::Rect>> MainWindow::runDetector(const std::vector<cv::Mat>& samples, const std::vector<cv::Size>& sizes) {
+  std::shared_ptr<tfdetect::Detector> detector;
+  {
+    // may be called from several pipeline workers
+    QMutexLocker lock(&detector_mutex_);
+    if (!detector_) { // init detector
+      if (QFile(detector_graph_file_).exists()) {
+        detector_ = tfdetect::CreateDetectorFromGraph("frozen_inference_graph.pb", detector_config_);
+      }
+      else {
+        throw std::runtime_error("Detector's frozen graph file not found! Skip...");
+      }
     }
+
+    detector = detector_;
   }
 
   // detect joints
-  std::vector<cv::Rect> ans;
-  auto knee_joints = detector_->detect(sample);
-  for (int k = 0; k < static_cast<int>(knee_joints.size()); ++k) {
-    auto r = knee_joints[k];
-    auto rect = cv::Rect(
-      r.x_min * sample.cols,
-      r.y_min * sample.rows,
-      (r.x_max - r.x_min) * sample.cols,
-      (r.y_max - r.y_min) * sample.rows);
-
-    ans.push_back(rect);
+  std::vector<std::vector<cv::Rect>> ans(samples.size());
+  auto all_joints = detector->detect(samples);
+  for (size_t i = 0; i < samples.size(); ++i) {
+    // boxes are normalized, so they are mapped to the source image directly
+    auto size = sizes[i];
+    for (auto r : all_joints[i]) {
+      auto x = cvRound(r.x_min * size.width);
+      auto y = cvRound(r.y_min * size.height);
+      auto rect = cv::Rect(x, y,
+        cvRound(r.x_max * size.width) - x,
+        cvRound(r.y_max * size.height) - y);
+
+      ans[i].push_back(rect & cv::Rect(cv::Point(), size));
+    }
   }
 
   return ans;
 }
 
-QVector<Classifier::Item> MainWindow::runClassifier(const cv::Mat& joint_area) {
-  cv::Mat working_image;
-  cv::resize(joint_area, working_image, classifier_.getFrameSize());
+void MainWindow::evaluateDetector(bool) {
+  // images spilled to disk are skipped
+  std::vector<cv::Mat> images;
+  for (auto item : view_queue_->items()) {
+    if (!item->src_image.empty()) images.push_back(item->src_image);
+  }
+
+  if (images.empty()) {
+    return;
+  }
+
+  loading_ind_->startAnimation();
+  QtConcurrent::run([this, images]() {
+    try {
+      emit detectorEvaluated(detectorTradeoff(images));
+    }
+    catch (const std::exception& e) {
+      emit detectorEvaluated(e.what());
+    }
+  });
+}
+
+QString MainWindow::detectorTradeoff(const std::vector<cv::Mat>& images) {
+  // warm up (detector's initialization)
+  runDetector({ images.front() }, { images.front().size() });
+
+  qint64 full_time = 0, working_time = 0;
+  qreal iou_sum = 0.0;
+  int boxes = 0, missed = 0;
+  QElapsedTimer timer;
+  for (const auto& image : images) {
+    timer.start();
+    auto reference = runDetector({ image }, { image.size() }).front();
+    full_time += timer.elapsed();
+
+    timer.start();
+    auto joints = runDetector({ detectorInput(image) }, { image.size() }).front();
+    working_time += timer.elapsed();
+
+    // best match for every box of full resolution
+    for (auto rect : reference) {
+      qreal best = 0.0;
+      for (auto it : joints) best = qMax(best, jaccard(rect, it));
+
+      iou_sum += best;
+      if (best < 0.5) ++missed;
+      ++boxes;
+    }
+  }
+
+  return QString("Images: %1\nInput size: %2\nFull resolution: %3 ms/image\nWorking resolution: %4 ms/image\n"
+    "Mean IoU: %5\nBoxes with IoU < 0.5: %6 of %7")
+    .arg(images.size())
+    .arg(detector_input_size_)
+    .arg(full_time * 1.0 / images.size(), 0, 'f', 1)
+    .arg(working_time * 1.0 / images.size(), 0, 'f', 1)
+    .arg(boxes ? iou_sum / boxes : 1.0, 0, 'f', 3)
+    .arg(missed)
+    .arg(boxes);
+}
+
+void MainWindow::evaluateContours(bool) {
+  saveCurrentGraphicsItems();
+
+  std::vector<std::pair<xr::contours_t, xr::contours_t>> samples;
+  for (auto item : view_queue_->items()) {
+    auto annotations = annotatedContours(item->graphics_items);
+    if (!item->contours.empty() && !annotations.empty()) {
+      samples.emplace_back(item->contours, std::move(annotations));
+    }
+  }
+
+  if (samples.empty()) {
+    QMessageBox::information(this, "Contours evaluation", "No items with both extracted contours and smart curves");
+    return;
+  }
+
+  loading_ind_->startAnimation();
+  QtConcurrent::run([this, samples]() {
+    emit contoursEvaluated(contoursReport(samples));
+  });
+}
+
+QString MainWindow::contoursReport(const std::vector<std::pair<xr::contours_t, xr::contours_t>>& samples) {
+  QElapsedTimer timer;
+  timer.start();
+
+  // all extracted contours of item are compared with each annotation at once
+  std::vector<xr::ContourPair> pairs;
+  for (const auto& sample : samples) {
+    for (const auto& annotation : sample.second) {
+      for (const auto& contour : sample.first) {
+        pairs.push_back({ &contour, &annotation });
+      }
+    }
+  }
+
+  auto metrics = xr::evaluateContours(pairs);
+
+  // every annotation is matched to the nearest (by mean distance) extracted contour
+  size_t annotations = 0, offset = 0;
+  double mean_sum = 0.0, rms_sum = 0.0, deviation_sum = 0.0, hausdorff_max = 0.0;
+  for (const auto& sample : samples) {
+    for (size_t k = 0; k < sample.second.size(); ++k, offset += sample.first.size()) {
+      auto best = std::min_element(metrics.begin() + offset, metrics.begin() + offset + sample.first.size(),
+        [](const xr::ContourMetrics& lhs, const xr::ContourMetrics& rhs) {
+          return lhs.mean_distance < rhs.mean_distance;
+        });
+
+      mean_sum += best->mean_distance;
+      rms_sum += best->rms_error;
+      deviation_sum += best->deviation;
+      hausdorff_max = std::max(hausdorff_max, best->hausdorff);
+      ++annotations;
+    }
+  }
+
+  return QString("Items: %1\nAnnotations: %2\nCompared pairs: %3 in %4 ms\n"
+    "Mean distance: %5 px\nRMS error: %6 px\nDeviation: %7 px\nMax Hausdorff distance: %8 px")
+    .arg(samples.size())
+    .arg(annotations)
+    .arg(pairs.size())
+    .arg(timer.elapsed())
+    .arg(mean_sum / annotations, 0, 'f', 2)
+    .arg(rms_sum / annotations, 0, 'f', 2)
+    .arg(deviation_sum / annotations, 0, 'f', 2)
+    .arg(hausdorff_max, 0, 'f', 2);
+}
+
+void MainWindow::saveContoursBaseline(bool) {
+  auto default_path = AppPrefs::read("last-baseline-path", "").toString();
+  auto path = QFileDialog::getExistingDirectory(this, "Save contours baseline", default_path);
+  if (path.isEmpty()) {
+    return;
+  }
+
+  AppPrefs::write("last-baseline-path", path);
+
+  // one file per item, named after its source file
+  int saved = 0, failed = 0;
+  for (auto item : view_queue_->items()) {
+    if (item->contours.empty()) continue;
 
-  qDebug() << "";
-  auto grades = classifier_.getGrade(working_image);
-  for (auto grade : grades) {
-    qDebug() << grade.mnemonic_code << grade.confidence;
+    auto filename = QDir(path).filePath(item->filename + ".contours");
+    if (xr::saveContours(item->contours, filename.toLocal8Bit().data())) ++saved;
+    else ++failed;
   }
 
-  return grades;
+  QMessageBox::information(this, "Contours baseline", QString("Saved: %1\nFailed: %2").arg(saved).arg(failed));
+}
+
+void MainWindow::compareContoursBaseline(bool) {
+  auto default_path = AppPrefs::read("last-baseline-path", "").toString();
+  auto path = QFileDialog::getExistingDirectory(this, "Load contours baseline", default_path);
+  if (path.isEmpty()) {
+    return;
+  }
+
+  std::vector<std::pair<xr::contours_t, xr::contours_t>> samples;
+  for (auto item : view_queue_->items()) {
+    auto filename = QDir(path).filePath(item->filename + ".contours");
+    if (item->contours.empty() || !QFile::exists(filename)) continue;
+
+    try {
+      samples.emplace_back(xr::loadContours(filename.toLocal8Bit().data()), item->contours);
+    }
+    catch (const std::exception& e) {
+      qDebug() << e.what();
+    }
+  }
+
+  if (samples.empty()) {
+    QMessageBox::information(this, "Contours evaluation", "No items with both extracted contours and baseline");
+    return;
+  }
+
+  loading_ind_->startAnimation();
+  QtConcurrent::run([this, samples]() {
+    emit contoursEvaluated(baselineReport(samples));
+  });
+}
+
+QString MainWindow::baselineReport(const std::vector<std::pair<xr::contours_t, xr::contours_t>>& samples) {
+  size_t baseline_count = 0, count = 0, unmatched = 0;
+  double mean_sum = 0.0, max_distance = 0.0;
+  for (const auto& sample : samples) {
+    auto deviation = xr::compareContours(sample.first, sample.second);
+    baseline_count += deviation.baseline_count;
+    count += deviation.count;
+    unmatched += deviation.unmatched;
+    mean_sum += deviation.mean_distance;
+    max_distance = std::max(max_distance, deviation.max_distance);
+  }
+
+  return QString("Items: %1\nBaseline contours: %2\nExtracted contours: %3\nUnmatched: %4\n"
+    "Mean distance: %5 px\nMax Hausdorff distance: %6 px")
+    .arg(samples.size())
+    .arg(baseline_count)
+    .arg(count)
+    .arg(unmatched)
+    .arg(mean_sum / samples.size(), 0, 'f', 3)
+    .arg(max_distance, 0, 'f', 3);
+}
+
+void MainWindow::compareFinders(bool) {
+  // images spilled to disk are skipped
+  std::vector<cv::Mat> images;
+  for (auto item : view_queue_->items()) {
+    if (!item->src_image.empty()) images.push_back(item->src_image);
+  }
+
+  if (images.empty()) {
+    return;
+  }
+
+  loading_ind_->startAnimation();
+  QtConcurrent::run([this, images]() {
+    try {
+      emit contoursEvaluated(findersReport(images));
+    }
+    catch (const std::exception& e) {
+      emit contoursEvaluated(e.what());
+    }
+  });
+}
+
+QString MainWindow::findersReport(const std::vector<cv::Mat>& images) {
+  qint64 radial_time = 0, border_time = 0;
+  size_t radial_count = 0, border_count = 0, unmatched = 0;
+  double mean_sum = 0.0, max_distance = 0.0;
+  QElapsedTimer timer;
+  for (const auto& image : images) {
+    // the same working size as the contours search of joints
+    cv::Mat sample;
+    auto factor = qMin(300.0 / image.cols, 300.0 / image.rows);
+    if (factor < 1.0) cv::resize(image, sample, cv::Size(), factor, factor, cv::INTER_AREA);
+    else sample = image;
+
+    xr::Image src(sample.cols, sample.rows);
+    for (int i = 0; i < sample.cols; ++i) {
+      for (int j = 0; j < sample.rows; ++j) {
+        src.byte(i, j) = sample.at<uchar>(j, i);
+      }
+    }
+
+    // preparation and threshold are shared, only the finders are timed on the same binary image
+    xr::MainProcessor processor(std::move(src), 0);
+    processor.findContours();
+
+    auto data = processor.data();
+    const auto mode = xr::ContoursFinder::SearchMode::FilterOut;
+    xr::DevContoursFinder radial(data);
+    xr::BorderContoursFinder border(data);
+
+    xr::Image radial_input = data->working, border_input = data->working;
+    timer.start();
+    auto reference = radial.find(&radial_input, mode, data->otsu_threshold);
+    radial_time += timer.nsecsElapsed();
+
+    timer.start();
+    auto contours = border.find(&border_input, mode, data->otsu_threshold);
+    border_time += timer.nsecsElapsed();
+
+    auto deviation = xr::compareContours(reference, contours);
+    radial_count += deviation.baseline_count;
+    border_count += deviation.count;
+    unmatched += deviation.unmatched;
+    mean_sum += deviation.mean_distance;
+    max_distance = std::max(max_distance, deviation.max_distance);
+  }
+
+  return QString("Images: %1\nRadial: %2 ms/image, %3 contours\nBorder following: %4 ms/image, %5 contours\n"
+    "Unmatched radial contours: %6\nMean distance: %7 px\nMax Hausdorff distance: %8 px")
+    .arg(images.size())
+    .arg(radial_time * 1e-6 / images.size(), 0, 'f', 2)
+    .arg(radial_count)
+    .arg(border_time * 1e-6 / images.size(), 0, 'f', 2)
+    .arg(border_count)
+    .arg(unmatched)
+    .arg(mean_sum / images.size(), 0, 'f', 3)
+    .arg(max_distance, 0, 'f', 3);
+}
+
+void MainWindow::onContoursEvaluated(const QString& report) {
+  if (pipeline_->isIdle()) {
+    loading_ind_->stopAnimation();
+  }
+
+  qDebug() << report;
+  QMessageBox::information(this, "Contours evaluation", report);
+}
+
+void MainWindow::onDetectorEvaluated(const QString& report) {
+  if (pipeline_->isIdle()) {
+    loading_ind_->stopAnimation();
+  }
+
+  qDebug() << report;
+  QMessageBox::information(this, "Detector resolution", report);
 }
 
 void MainWindow::openFileDICOM(bool) {
@@ -1070,7 +1725,13 @@ void MainWindow::openFileDICOM(bool) {
   auto default_path = AppPrefs::read("last-dicom-path", "").toString();
   auto path = QFileDialog::getOpenFileName(this, "Load DICOM file", default_path, filters);
   if (!path.isEmpty()) {
-    openDICOM(path);
+    try {
+      open(QFileInfo(path).fileName(), readDICOM(path, dicom_options_));
+    }
+    catch (const std::exception& e) {
+      QMessageBox::warning(this, "Warning", e.what());
+    }
+
     AppPrefs::write("last-dicom-path", path.left(path.lastIndexOf('/')) + "/");
   }
 }
@@ -1081,8 +1742,8 @@ void MainWindow::openFolderDICOM(bool) {
   if (!path.isEmpty()) {
     auto files = QDir(path).entryList(QDir::Files);
     for (auto filename : files) {
-      if (filename.endsWith("DCM") || filename.endsWith("DICOM") || filename.endsWith("dicom") || filename.endsWith("dcm")) {
-        openDICOM(path + '/' + filename);
+      if (isDICOM(filename)) {
+        openLater(path + '/' + filename);
       }
     }
 
@@ -1090,46 +1751,13 @@ void MainWindow::openFolderDICOM(bool) {
   }
 }
 
-void MainWindow::openDICOM(const QString& path) {
-  gdcm::ImageReader reader;
-  reader.SetFileName(path.toStdString().c_str());
-  if (reader.Read()) {
-    auto filename = QFileInfo(path).fileName();
-    auto image = reader.GetImage();
-
-    std::vector<char> buffer(image.GetBufferLength());
-    image.GetBuffer(buffer.data());
-
-    int pixel_type;
-    auto pixel_format = image.GetPixelFormat().GetScalarType();
-    if (pixel_format == gdcm::PixelFormat::UINT8) pixel_type = CV_8UC1;
-    else if (pixel_format == gdcm::PixelFormat::INT8) pixel_type = CV_8SC1;
-    else if (pixel_format == gdcm::PixelFormat::UINT16) pixel_type = CV_16UC1;
-    else if (pixel_format == gdcm::PixelFormat::INT16) pixel_type = CV_16SC1;
-    else if (pixel_format == gdcm::PixelFormat::FLOAT32) pixel_type = CV_32FC1;
-    else if (pixel_format == gdcm::PixelFormat::FLOAT64) pixel_type = CV_64FC1;
-    else if (pixel_format == gdcm::PixelFormat::UINT32) pixel_type = CV_8UC4;
-    else if (pixel_format == gdcm::PixelFormat::INT32) pixel_type = CV_8SC4;
-    else {
-      QMessageBox::warning(this, "Warning", "Unknown pixel format of image in DICOM!");
-      return;
-    }
-
-    cv::Mat sample;
-    cv::Mat img(image.GetRows(), image.GetColumns(), pixel_type, buffer.data());
-    cv::cvtColor(img, sample, cv::COLOR_GRAY2RGB);
-
-    open(filename, sample);
-  }
-}
-
 void MainWindow::openSample(bool) {
   auto filters = "Image files (*.bmp *.png *.jpg *.jpeg);;";
   auto default_path = AppPrefs::read("last-file-path", "").toString();
   auto path = QFileDialog::getOpenFileName(this, "Load image", default_path, filters);
   if (!path.isEmpty()) {
     auto filename = QFileInfo(path).fileName();
-    auto sample = cv::imread(path.toLocal8Bit().data(), cv::IMREAD_COLOR);
+    auto sample = cv::imread(path.toLocal8Bit().data(), cv::IMREAD_GRAYSCALE);
 
     AppPrefs::write("last-file-path", path.left(path.lastIndexOf('/')) + "/");
     open(filename, sample);
@@ -1142,9 +1770,7 @@ void MainWindow::openSamples(bool) {
   auto files = QFileDialog::getOpenFileNames(this, "Load images...", default_path, filters);
   if (!files.isEmpty()) {
     for (auto path : files) {
-      auto filename = QFileInfo(path).fileName();
-      auto sample = cv::imread(path.toLocal8Bit().data(), cv::IMREAD_COLOR);
-      open(filename, sample);
+      openLater(path);
     }
 
     AppPrefs::write("last-files-path", files.first().left(files.first().lastIndexOf('/')) + "/");
@@ -1158,8 +1784,7 @@ void MainWindow::openFolder(bool) {
     auto files = QDir(path).entryList(QDir::Files);
     for (auto filename : files) {
       if (filename.endsWith("bmp") || filename.endsWith("png") || filename.endsWith("jpg") || filename.endsWith("jpeg")) {
-        auto sample = cv::imread((path + '/' + filename).toLocal8Bit().data(), cv::IMREAD_COLOR);
-        open(QFileInfo(filename).fileName(), sample);
+        openLater(path + '/' + filename);
       }
     }
 
@@ -1170,16 +1795,53 @@ void MainWindow::openFolder(bool) {
 void MainWindow::open(const QString& filename, cv::Mat sample) {
   auto item = std::make_shared<Metadata>();
   item->filename = filename;
-  item->src_image = sample.clone();
+  item->src_image = sample;
   item->image = sample;
 
+  addItem(item);
+
+  // detection and classification in background
+  if (classifier_enabled_ || precompute_gradient_) {
+    loading_ind_->startAnimation();
+    pipeline_->submit(item, "detect");
+  }
+}
+
+void MainWindow::openLater(const QString& path) {
+  auto item = std::make_shared<Metadata>();
+  item->filename = QFileInfo(path).fileName();
+  item->path = path;
+
+  // new series of files
+  if (ingest_done_ == ingest_total_) {
+    ingest_total_ = ingest_done_ = 0;
+    ingest_bytes_ = 0;
+    ingest_timer_.start();
+  }
+
+  ++ingest_total_;
+  updateIngestStatus();
+
+  loading_ind_->startAnimation();
+  pipeline_->submit(item, "decode");
+}
+
+void MainWindow::addItem(Metadata::HardPtr item) {
+  memory_.add(item);
   view_queue_->addItem(item);
+  shrinkMemory();
 
   proc_menu_->setEnabled(true);
   calibrate_->setEnabled(true);
   transform_menu_->setEnabled(true);
 }
 
+void MainWindow::shrinkMemory() {
+  memory_.shrink([this](Metadata* item) {
+    return item == current_item_.get() || pipeline_->contains(item);
+  });
+}
+
 void MainWindow::setCalibration() {
   if (viewport_->mode() != Viewport::Mode::View) {
     for (auto it : { draw_poly_, draw_circle_, draw_line_, draw_angle_, draw_cobb_angle_ }) {
@@ -1212,8 +1874,8 @@ void MainWindow::showSettings() {
 void MainWindow::mousePosChanged(const QPoint& pt) {
   if (current_item_) {
     if (0 <= pt.x() && pt.x() < current_item_->image.cols && 0 <= pt.y() && pt.y() < current_item_->image.rows) {
-      auto val = current_item_->image.at<cv::Vec3b>(pt.y(), pt.x());
-      viewport_->setLabelText(QString("X: %1 Y: %2 Val: %3").arg(pt.x()).arg(pt.y()).arg(val[0]));
+      auto val = current_item_->image.at<uchar>(pt.y(), pt.x());
+      viewport_->setLabelText(QString("X: %1 Y: %2 Val: %3").arg(pt.x()).arg(pt.y()).arg(val));
     }
   }
 }
@@ -1299,12 +1961,7 @@ void MainWindow::smartCurve(bool) {
 
     // make gradient for current image
     if (current_item_ && current_item_->gradient.empty()) {
-      cv::Mat temp;
-      cv::GaussianBlur(current_item_->src_image, temp, cv::Size(3, 3), 0, 0, cv::BORDER_DEFAULT);
-      // Convert the image to grayscale
-      cv::cvtColor(temp, temp, cv::COLOR_RGB2GRAY);
-
-      current_item_->gradient = gvf(temp, 0.04, 55);
+      prepareGradient(current_item_);
 
       // current_item_->gradient.convertTo(current_item_->image, CV_8UC1, 255);
       // cv::cvtColor(current_item_->image, current_item_->image, cv::COLOR_GRAY2RGB);
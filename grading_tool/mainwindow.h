@@ -1,16 +1,22 @@
 #pragma once
 #include <QMainWindow>
-#include <QLinkedList>
+#include <QMutex>
+#include <QElapsedTimer>
 #include <QVBoxLayout>
 #include <QChartView>
 
 #include <opencv2/opencv.hpp>
+#include <processor_pool.h>
 
 #include "tfdetect/tfdetect.h"
 #include "viewport.h"
 #include "classifier.h"
 #include "metadata.h"
 #include "tfdetect.h"
+#include "inference_cache.h"
+#include "pipeline.h"
+#include "dicom_reader.h"
+#include "memory_manager.h"
 
 class QTableWidget;
 class QCustomPlot;
@@ -27,6 +33,15 @@ class MainWindow : public QMainWindow
 {
   Q_OBJECT
 
+public:
+  // parts of the current item refreshed by updateCurrentItem
+  enum Update {
+    UpdateImage = 0x1,    // image plane changed (filters)
+    UpdateJoints = 0x2,   // detection or classification finished
+    UpdateGraphics = 0x4, // item or its orientation changed: viewport state and graphics items
+    UpdateAll = UpdateImage | UpdateJoints | UpdateGraphics
+  };
+
 protected:
   static const QString ic_line;
   static const QString ic_zoom;
@@ -45,6 +60,7 @@ protected:
   QWidget* loading_area_;
   ProgressIndicator* loading_ind_;
   QLabel* calib_coef_;
+  QLabel* ingest_status_;
   QWidget* working_area_;
   QTableWidget* right_panel_;
 
@@ -65,10 +81,27 @@ protected:
   Metadata::HardPtr current_item_;
   QString detector_graph_file_ = "frozen_inference_graph.pb";
   std::shared_ptr<tfdetect::Detector> detector_;
-  QLinkedList<Metadata::HardPtr> process_queue_;
-  QSet<Metadata*> in_process_;
+  tfdetect::SessionConfig detector_config_;
+  int detector_input_size_ = 1024; // max side of the detector's input, 0 - full resolution
+  QMutex detector_mutex_;
+  Pipeline* pipeline_;
+  MemoryBudget decode_budget_; // decoded images not yet taken by UI
+  DicomOptions dicom_options_;
+  QMutex dicom_mutex_; // options are changed live, while decode workers read them
+  QVariantList pipeline_config_; // preferences which require restart of the pipeline
+
+  // files opened in background
+  int ingest_total_ = 0;
+  int ingest_done_ = 0;
+  qint64 ingest_bytes_ = 0;
+  QElapsedTimer ingest_timer_;
   bool classifier_enabled_ = false;
+  bool precompute_gradient_ = false;
+  QList<Metadata::HardPtr> unclassified_; // spilled items waiting for classification
   Classifier classifier_;
+  xr::ProcessorPool processor_pool_;
+  InferenceCache inference_cache_;
+  MemoryManager memory_;
 
 protected:
   void makeMenuFile();
@@ -80,6 +113,27 @@ protected:
   QtCharts::QChartView* makeGraph(const QString& title, QColor color, const QVector<Classifier::Item>& data);
 
   void initClassifier();
+  DicomOptions dicomOptions();
+
+  // after the pipeline restart: dropped items and all not classified ones are submitted again
+  void resubmit(const QList<Metadata::HardPtr>& dropped);
+
+  // spilled items are loaded back and classified a batch at a time, when the pipeline is idle
+  void submitUnclassified();
+
+  // stages of the images processing pipeline (run in worker threads)
+  void initPipeline();
+  void decodeStage(Pipeline::Job& job);
+  void detectStage(std::vector<Pipeline::Job>& jobs);
+  void cropStage(Pipeline::Job& job);
+  void classifyStage(Pipeline::Job& job);
+  void gradientStage(Pipeline::Job& job);
+
+  // load GVF gradient from the cache or compute it
+  void prepareGradient(Metadata::HardPtr data);
+
+  // take processor from the pool and configure it by current preferences
+  xr::ProcessorPool::Processor acquireProcessor();
   void saveCurrentContoursToImage();
 
   Q_SLOT void openSample(bool);
@@ -89,30 +143,57 @@ protected:
   Q_SLOT void openFileDICOM(bool);
   Q_SLOT void openFolderDICOM(bool);
 
-  void open(const QString& filename, cv::Mat image);
-  void openDICOM(const QString& path);
+  void open(const QString& filename, cv::Mat image); // image - 8-bit gray
+  void openLater(const QString& path); // decode in the pipeline
+  void addItem(Metadata::HardPtr item);
+
+  // fit opened items into the memory budget (current and processed items are kept)
+  void shrinkMemory();
 
   Q_SLOT void setCalibration();
   Q_SLOT void resetCalibration();
   Q_SLOT void showSettings();
 
+  // compare detection on full and working resolution over opened items
+  Q_SLOT void evaluateDetector(bool);
+  QString detectorTradeoff(const std::vector<cv::Mat>& images);
+
+  // compare extracted contours with smart curve annotations over opened items
+  Q_SLOT void evaluateContours(bool);
+
+  // @param samples: extracted and annotated contours of every item
+  static QString contoursReport(const std::vector<std::pair<xr::contours_t, xr::contours_t>>& samples);
+
+  // dump extracted contours of opened items to compare them with another build
+  // of contours_extractor (e.g. XR_SINGLE_PRECISION against double)
+  Q_SLOT void saveContoursBaseline(bool);
+  Q_SLOT void compareContoursBaseline(bool);
+
+  // @param samples: baseline and extracted contours of every item
+  static QString baselineReport(const std::vector<std::pair<xr::contours_t, xr::contours_t>>& samples);
+
+  // speed and agreement of the border following finder against the radial one over opened items
+  Q_SLOT void compareFinders(bool);
+  static QString findersReport(const std::vector<cv::Mat>& images);
+
   // process (or display) specified item
   Q_SLOT void setItemAsCurrent(Metadata::HardPtr data); 
 
-  // update all data of current item
-  Q_SLOT void updateCurrentItem(); 
+  // update specified parts of current item, see Update
+  Q_SLOT void updateCurrentItem(int what = UpdateAll);
   
   void saveCurrentGraphicsItems();
 
   Q_SLOT void onItemProcessed(Metadata::HardPtr data);
+  Q_SLOT void onStageFinished(Metadata::HardPtr data, const QString& stage);
+  void updateIngestStatus();
   Q_SLOT void onContoursFound(const QVector<QVector<QPoint>>& contours);
   Q_SLOT void onContoursFoundBase(const xr::contours_t& contours);
+  Q_SLOT void onDetectorEvaluated(const QString& report);
+  Q_SLOT void onContoursEvaluated(const QString& report);
 
   Q_SLOT void calibrateForLength(qreal length);
 
-  // run models to localize joints and classify AO grades
-  Q_SLOT void runOnData(Metadata::HardPtr data);
-
   // run models to localize joints and classify AO grades
   Q_SLOT void findContoursOnData(Metadata::HardPtr data);
   Q_SLOT void findContoursOnImageImpl(Metadata::HardPtr data);
@@ -126,9 +207,10 @@ protected:
   Q_SLOT void mousePosChanged(const QPoint&);
   Q_SLOT void mousePosOutOfImage();
   
-  Q_SIGNAL void itemProcessed(Metadata::HardPtr data);
   Q_SIGNAL void contoursFoundBase(const xr::contours_t& contours);
   Q_SIGNAL void contoursFound(const QVector<QVector<QPoint>>& contours);
+  Q_SIGNAL void detectorEvaluated(const QString& report);
+  Q_SIGNAL void contoursEvaluated(const QString& report);
 
   Q_SLOT void drawLine(bool);
   Q_SLOT void drawCircle(bool);
@@ -158,6 +240,11 @@ public:
 
   void init();
 
-  QVector<Classifier::Item> runClassifier(const cv::Mat& joint_area);
+  // downscale image to the working resolution of the detector
+  cv::Mat detectorInput(const cv::Mat& image) const;
+
   std::vector<cv::Rect> runDetector(const cv::Mat& input_image);
+
+  // boxes are mapped back to the specified sizes of source images
+  std::vector<std::vector<cv::Rect>> runDetector(const std::vector<cv::Mat>& input_images, const std::vector<cv::Size>& image_sizes);
 };
@@ -0,0 +1,151 @@
+#include "memory_manager.h"
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <vector>
+
+MemoryManager::MemoryManager(const QString& dir, qint64 budget) :
+  dir_(dir + "/" + QString::number(QCoreApplication::applicationPid())),
+  budget_(budget) {
+  dir_.mkpath(".");
+}
+
+MemoryManager::~MemoryManager() {
+  dir_.removeRecursively();
+}
+
+void MemoryManager::setBudget(qint64 budget) {
+  budget_ = budget;
+}
+
+qint64 MemoryManager::bytes(const Metadata& item) {
+  auto size = [](const cv::Mat& m) { return static_cast<qint64>(m.total() * m.elemSize()); };
+
+  auto ans = size(item.src_image) + size(item.gradient);
+  if (item.image.data != item.src_image.data) ans += size(item.image);
+  if (item.detection_image.data != item.src_image.data) ans += size(item.detection_image);
+  if (item.display_image.data != item.image.data) ans += size(item.display_image);
+  return ans;
+}
+
+qint64 MemoryManager::usage() {
+  cleanup();
+
+  qint64 ans = 0;
+  for (const auto& entry : entries_) {
+    if (auto item = entry.item.lock()) ans += bytes(*item);
+  }
+
+  return ans;
+}
+
+int MemoryManager::indexOf(Metadata* item) const {
+  for (int i = 0; i < entries_.size(); ++i) {
+    if (entries_[i].item.lock().get() == item) return i;
+  }
+
+  return -1;
+}
+
+void MemoryManager::cleanup() {
+  for (int i = entries_.size() - 1; i >= 0; --i) {
+    if (entries_[i].item.expired()) {
+      if (!entries_[i].spill_file.isEmpty()) {
+        QFile::remove(entries_[i].spill_file + ".src.png");
+        QFile::remove(entries_[i].spill_file + ".img.png");
+      }
+
+      entries_.removeAt(i);
+    }
+  }
+}
+
+void MemoryManager::add(Metadata::HardPtr item) {
+  if (indexOf(item.get()) < 0) {
+    Entry entry;
+    entry.item = item;
+    entries_.push_back(entry);
+  }
+}
+
+void MemoryManager::touch(Metadata::HardPtr item) {
+  auto idx = indexOf(item.get());
+  if (idx < 0) {
+    add(item);
+    return;
+  }
+
+  auto entry = entries_.takeAt(idx);
+  if (!entry.spill_file.isEmpty()) {
+    restore(entry, *item);
+  }
+
+  entries_.push_back(entry);
+}
+
+void MemoryManager::spill(Entry& entry, Metadata& item) {
+  auto filename = dir_.filePath(QString::number(next_id_++));
+  const std::vector<int> params = { cv::IMWRITE_PNG_COMPRESSION, 1 };
+
+  entry.shared_image = item.image.data == item.src_image.data;
+  if (!cv::imwrite((filename + ".src.png").toLocal8Bit().data(), item.src_image, params) ||
+    (!entry.shared_image && !cv::imwrite((filename + ".img.png").toLocal8Bit().data(), item.image, params))) {
+    qWarning() << "can't spill image to" << filename;
+    return;
+  }
+
+  entry.spill_file = filename;
+  item.src_image.release();
+  item.image.release();
+  item.display_image.release();
+  item.display_source.release();
+}
+
+void MemoryManager::restore(Entry& entry, Metadata& item) {
+  auto src_image = cv::imread((entry.spill_file + ".src.png").toLocal8Bit().data(), cv::IMREAD_UNCHANGED);
+  auto image = entry.shared_image ? src_image : cv::imread((entry.spill_file + ".img.png").toLocal8Bit().data(), cv::IMREAD_UNCHANGED);
+
+  // item stays spilled, the next touch tries again
+  if (src_image.empty() || image.empty()) {
+    qWarning() << "can't restore spilled image from" << entry.spill_file;
+    return;
+  }
+
+  item.src_image = src_image;
+  item.image = image;
+
+  QFile::remove(entry.spill_file + ".src.png");
+  QFile::remove(entry.spill_file + ".img.png");
+  entry.spill_file.clear();
+}
+
+void MemoryManager::shrink(const std::function<bool(Metadata*)>& pinned) {
+  if (budget_ <= 0) {
+    return;
+  }
+
+  auto used = usage();
+
+  // the first pass drops planes which can be computed again, the second one spills images
+  for (int pass = 0; pass < 2 && used > budget_; ++pass) {
+    for (auto& entry : entries_) {
+      if (used <= budget_) break;
+
+      auto item = entry.item.lock();
+      if (!item || pinned(item.get())) continue;
+
+      auto before = bytes(*item);
+      if (pass == 0) {
+        item->gradient.release();
+        item->detection_image.release();
+        item->display_image.release();
+        item->display_source.release();
+      }
+      else if (entry.spill_file.isEmpty() && !item->src_image.empty()) {
+        spill(entry, *item);
+      }
+
+      used -= before - bytes(*item);
+    }
+  }
+}
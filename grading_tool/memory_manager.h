@@ -0,0 +1,46 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <QDir>
+#include <QList>
+
+#include "metadata.h"
+
+// Keeps decoded planes of opened items within the memory budget.
+// Least recently used items lose recomputable planes (gradient, detector's input, display) first,
+// then their images are spilled to disk and loaded back when the item is used again.
+class MemoryManager {
+protected:
+  struct Entry {
+    std::weak_ptr<Metadata> item;
+    QString spill_file; // empty if images are in memory
+    bool shared_image = false; // image is src_image (no filters applied)
+  };
+
+  QDir dir_;
+  qint64 budget_;
+  QList<Entry> entries_; // the last one is the most recently used
+  int next_id_ = 0;
+
+  int indexOf(Metadata* item) const;
+  void cleanup();
+  void spill(Entry& entry, Metadata& item);
+  void restore(Entry& entry, Metadata& item);
+
+public:
+  MemoryManager(const QString& dir, qint64 budget);
+  ~MemoryManager();
+
+  void setBudget(qint64 budget);
+
+  static qint64 bytes(const Metadata& item);
+  qint64 usage();
+
+  void add(Metadata::HardPtr item);
+
+  // make item the most recently used, spilled images are loaded back
+  void touch(Metadata::HardPtr item);
+
+  // release planes of not pinned items until the usage fits the budget
+  void shrink(const std::function<bool(Metadata*)>& pinned);
+};
@@ -9,6 +9,7 @@
 #include <opencv2/opencv.hpp>
 #include "classifier.h"
 #include "types.h"
+#include "utils.h"
 
 struct Metadata {
   using HardPtr = std::shared_ptr<Metadata>;
@@ -18,11 +19,19 @@ struct Metadata {
   };
 
 public:
-  cv::Mat image;
-  cv::Mat src_image;
-  cv::Mat gradient;
+  cv::Mat image;     // displayed plane (src_image or result of filters), converted to RGB only by the viewport
+  cv::Mat src_image; // 8-bit gray, the source of truth
+  cv::Mat gradient;  // float GVF magnitude, computed lazily and dropped under memory pressure
+  cv::Mat detection_image; // src_image downscaled to the detector's working resolution
+  cv::Mat display_image;  // image with rotation and flips applied, dropped under memory pressure
+  cv::Mat display_source; // plane display_image was made from
+  Orientation display_orientation;
+  QByteArray content_hash; // hash of src_image, key for the inference cache
   QString filename;
+  QString path; // source file, if image isn't decoded yet
+  qint64 decode_budget = 0; // bytes of the decode budget held until UI takes the item
   QVector<Joint> joints;
+  bool classified = false; // joints are detected and graded (an image may have none)
   xr::contours_t contours;
   bool already_display = false;
   ViewportState viewport_state;
@@ -30,4 +39,5 @@ public:
   QJsonArray graphics_items;
   QVector<Transformation> transformations;
   int rotation = 0;
+  int revision = 0; // incremented on every change of image or transformations
 };
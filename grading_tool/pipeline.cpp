@@ -0,0 +1,149 @@
+#include "pipeline.h"
+#include <algorithm>
+#include <stdexcept>
+#include <QDebug>
+
+Pipeline::Pipeline(QObject* parent) : QObject(parent) {
+}
+
+Pipeline::~Pipeline() {
+  stop();
+}
+
+int Pipeline::stageIndex(const QString& name) const {
+  for (size_t i = 0; i < stages_.size(); ++i) {
+    if (stages_[i].name == name) return static_cast<int>(i);
+  }
+
+  throw std::runtime_error("Unknown pipeline stage: " + name.toStdString());
+}
+
+void Pipeline::addStage(const QString& name, int workers, StageFunc func, size_t capacity) {
+  addBatchStage(name, workers, [func](std::vector<Job>& jobs) {
+    for (auto& job : jobs) func(job);
+  }, 1, capacity);
+}
+
+void Pipeline::addBatchStage(const QString& name, int workers, BatchFunc func, size_t max_batch, size_t capacity) {
+  if (running_) {
+    throw std::runtime_error("Can't add stage to running pipeline");
+  }
+
+  Stage stage;
+  stage.name = name;
+  stage.workers = qMax(1, workers);
+  stage.max_batch = std::max<size_t>(1, max_batch);
+  stage.func = std::move(func);
+  stage.queue = std::make_unique<BoundedQueue<Job>>(capacity);
+  stages_.push_back(std::move(stage));
+}
+
+void Pipeline::setWorkers(const QString& name, int workers) {
+  if (running_) {
+    throw std::runtime_error("Can't change workers of running pipeline");
+  }
+
+  stages_[stageIndex(name)].workers = qMax(1, workers);
+}
+
+void Pipeline::start() {
+  if (running_) {
+    return;
+  }
+
+  running_ = true;
+  for (size_t i = 0; i < stages_.size(); ++i) {
+    stages_[i].queue->reopen();
+    for (int k = 0; k < stages_[i].workers; ++k) {
+      threads_.emplace_back(&Pipeline::run, this, static_cast<int>(i));
+    }
+  }
+}
+
+QList<Metadata::HardPtr> Pipeline::stop() {
+  if (!running_) {
+    return {};
+  }
+
+  for (auto& stage : stages_) {
+    stage.queue->close();
+  }
+
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+
+  threads_.clear();
+  running_ = false;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto dropped = in_process_.values();
+  in_process_.clear();
+  return dropped;
+}
+
+void Pipeline::submit(Metadata::HardPtr data, const QString& stage, bool urgent) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (in_process_.contains(data.get())) {
+      return;
+    }
+
+    in_process_.insert(data.get(), data);
+  }
+
+  Job job;
+  job.data = data;
+  stages_[stageIndex(stage)].queue->put(std::move(job), urgent);
+}
+
+bool Pipeline::contains(Metadata* data) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return in_process_.contains(data);
+}
+
+bool Pipeline::isIdle() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return in_process_.isEmpty();
+}
+
+void Pipeline::run(int stage) {
+  auto& current = stages_[stage];
+  bool last = stage + 1 == static_cast<int>(stages_.size());
+
+  std::vector<Job> jobs;
+  while (current.queue->pop(jobs, current.max_batch)) {
+    try {
+      current.func(jobs);
+    }
+    catch (const std::exception& e) {
+      qWarning() << current.name << e.what();
+      for (auto& job : jobs) job.done = true;
+    }
+
+    for (auto& job : jobs) {
+      emit stageFinished(job.data, current.name);
+
+      if (job.done || last) {
+        finish(job.data);
+      }
+      else {
+        stages_[stage + 1].queue->push(std::move(job));
+      }
+    }
+
+    jobs.clear();
+  }
+}
+
+void Pipeline::finish(const Metadata::HardPtr& data) {
+  bool empty;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    in_process_.remove(data.get());
+    empty = in_process_.isEmpty();
+  }
+
+  emit itemProcessed(data);
+  if (empty) emit idle();
+}
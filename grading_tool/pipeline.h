@@ -0,0 +1,191 @@
+#pragma once
+#include <deque>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+#include <QObject>
+#include <QString>
+#include <QHash>
+#include <QList>
+
+#include <opencv2/opencv.hpp>
+#include "metadata.h"
+
+// FIFO queue with a capacity limit (0 - unlimited), pop blocks until an item appears or the queue is closed
+template<class T>
+class BoundedQueue {
+protected:
+  std::deque<T> items_;
+  size_t capacity_;
+  bool closed_ = false;
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+
+public:
+  explicit BoundedQueue(size_t capacity = 0) : capacity_(capacity) {}
+
+  // waits while the queue is full
+  void push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock, [this] { return closed_ || !capacity_ || items_.size() < capacity_; });
+    if (closed_) return;
+
+    items_.push_back(std::move(item));
+    not_empty_.notify_one();
+  }
+
+  // never waits (for the UI thread); urgent items go to the head of the queue
+  void put(T item, bool urgent = false) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (closed_) return;
+
+    if (urgent) items_.push_front(std::move(item));
+    else items_.push_back(std::move(item));
+    not_empty_.notify_one();
+  }
+
+  // takes up to max_count items (at least one), returns false if the queue was closed
+  bool pop(std::vector<T>& items, size_t max_count = 1) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return closed_ || !items_.empty(); });
+    if (closed_) return false;
+
+    while (!items_.empty() && items.size() < max_count) {
+      items.push_back(std::move(items_.front()));
+      items_.pop_front();
+    }
+
+    not_full_.notify_all();
+    return true;
+  }
+
+  // wake up all waiting threads, remaining items are dropped
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    items_.clear();
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+  void reopen() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    items_.clear();
+    closed_ = false;
+  }
+};
+
+// Limit of memory held by items in flight, acquire waits while the budget is exhausted
+class MemoryBudget {
+protected:
+  qint64 limit_;
+  qint64 used_ = 0;
+  bool closed_ = false;
+  std::mutex mutex_;
+  std::condition_variable released_;
+
+public:
+  explicit MemoryBudget(qint64 limit = 0) : limit_(limit) {}
+
+  // item bigger than the whole budget passes when nothing else is held; returns false if closed
+  bool acquire(qint64 bytes) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    released_.wait(lock, [&] { return closed_ || limit_ <= 0 || !used_ || used_ + bytes <= limit_; });
+    if (closed_) return false;
+
+    used_ += bytes;
+    return true;
+  }
+
+  void release(qint64 bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    used_ = std::max<qint64>(0, used_ - bytes);
+    released_.notify_all();
+  }
+
+  // wake up all waiting threads
+  void close() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = true;
+    released_.notify_all();
+  }
+
+  // applies to the next acquire, memory which is already held stays accounted
+  void setLimit(qint64 limit) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    limit_ = limit;
+    released_.notify_all();
+  }
+
+  // memory acquired before close stays accounted, holders release it as usual
+  void open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    closed_ = false;
+  }
+};
+
+// Staged processing of images: every stage has own worker threads and an input queue,
+// so decoding, detection, classification and contours search of different images overlap.
+// Queues between stages are bounded, so fast stages don't accumulate unlimited number of images.
+class Pipeline : public QObject {
+  Q_OBJECT
+
+public:
+  struct Job {
+    Metadata::HardPtr data;
+    std::vector<cv::Rect> joints;
+    std::vector<cv::Mat> crops;
+    bool done = false; // skip remaining stages
+  };
+
+  using StageFunc = std::function<void(Job&)>;
+  using BatchFunc = std::function<void(std::vector<Job>&)>;
+
+protected:
+  struct Stage {
+    QString name;
+    int workers;
+    size_t max_batch;
+    BatchFunc func;
+    std::unique_ptr<BoundedQueue<Job>> queue;
+  };
+
+  std::vector<Stage> stages_;
+  std::vector<std::thread> threads_;
+  QHash<Metadata*, Metadata::HardPtr> in_process_;
+  std::mutex mutex_;
+  bool running_ = false;
+
+  int stageIndex(const QString& name) const;
+  void run(int stage);
+  void finish(const Metadata::HardPtr& data);
+
+public:
+  explicit Pipeline(QObject* parent = nullptr);
+  ~Pipeline();
+
+  // capacity - limit of the stage's input queue
+  void addStage(const QString& name, int workers, StageFunc func, size_t capacity = 4);
+
+  // stage takes all queued items (up to max_batch) at once, e.g. for batched inference
+  void addBatchStage(const QString& name, int workers, BatchFunc func, size_t max_batch, size_t capacity = 4);
+  void setWorkers(const QString& name, int workers);
+
+  void start();
+  // waits for workers; returns items which were queued or in process, they are dropped
+  QList<Metadata::HardPtr> stop();
+
+  // put item to the input of specified stage, urgent items are processed first
+  void submit(Metadata::HardPtr data, const QString& stage, bool urgent = false);
+  bool contains(Metadata* data);
+  bool isIdle();
+
+  Q_SIGNAL void stageFinished(Metadata::HardPtr data, const QString& stage);
+  Q_SIGNAL void itemProcessed(Metadata::HardPtr data);
+  Q_SIGNAL void idle();
+};
@@ -129,7 +129,8 @@ SettingsWindow::SettingsWindow(QWidget* parent) :
   auto extraction_method = create_combo_box(l, "Contours extraction method:", "extraction_method", r++, { 
     "Radial method", 
     "Rosenfeld method", 
-    "Simple method" });
+    "Simple method",
+    "Border following" });
 
   //
   auto scroll_area = new QScrollArea(this);
@@ -157,7 +158,8 @@ SettingsWindow::SettingsWindow(QWidget* parent) :
     auto em = extraction_method->currentIndex();
     if (em == 0) AppPrefs::write("extraction_method", "radial");
     else if (em == 1) AppPrefs::write("extraction_method", "rosenfeld");
-    else AppPrefs::write("extraction_method", "simple");
+    else if (em == 2) AppPrefs::write("extraction_method", "simple");
+    else AppPrefs::write("extraction_method", "border");
   });
 
   init();
@@ -201,5 +203,6 @@ void SettingsWindow::init() {
   auto em = AppPrefs::read("extraction_method", "radial").toString();
   if (em == "radial") extraction_method->setCurrentIndex(0);
   else if (em == "rosenfeld") extraction_method->setCurrentIndex(1);
+  else if (em == "border") extraction_method->setCurrentIndex(3);
   else extraction_method->setCurrentIndex(2);
 }
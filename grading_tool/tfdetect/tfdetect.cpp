@@ -2,6 +2,7 @@
 #include "tfwrapper.h"
 
 #include <memory>
+#include <mutex>
 #include <functional>
 
 namespace tfdetect
@@ -10,7 +11,7 @@ namespace tfdetect
   {
     class GraphProtoDetector : public Detector {
     public:
-      GraphProtoDetector(const std::string& path_to_graph_proto) :
+      GraphProtoDetector(const std::string& path_to_graph_proto, const SessionConfig& config) :
         graph_(new tfwrapper::Graph()),
         input_names_(1),
         output_names_(3) 
@@ -19,7 +20,10 @@ namespace tfdetect
         tfwrapper::Buffer graph_buffer(path_to_graph_proto);
         tfwrapper::ImportGraphDefOptions opts;
         graph_->ImportGraphDef(graph_buffer, opts);
-        session_ = std::move(std::unique_ptr<tfwrapper::Session>(new tfwrapper::Session(*graph_)));
+
+        tfwrapper::SessionOptions session_opts;
+        session_opts.SetThreads(config.intra_op_threads, config.inter_op_threads);
+        session_ = std::move(std::unique_ptr<tfwrapper::Session>(new tfwrapper::Session(*graph_, session_opts)));
 
         // find the input placeholder
         graph_->GetOperation("image_tensor").Output(0, input_names_.at(0));
@@ -37,18 +41,62 @@ namespace tfdetect
       }
 
       virtual std::vector<Detection> detect(const cv::Mat& input_image) const override {
-        // the graph expects images of type uint8
-        cv::Mat im_to_use;
-        if (input_image.depth() != CV_8U) {
-          input_image.convertTo(im_to_use, CV_8UC3);
+        return detect(std::vector<cv::Mat>{ input_image }).front();
+      }
+
+      virtual std::vector<std::vector<Detection>> detect(const std::vector<cv::Mat>& input_images) const override {
+        std::vector<std::vector<Detection>> results(input_images.size());
+
+        // the graph takes a batch of images of the same size, so group them by size
+        std::vector<bool> used(input_images.size(), false);
+        for (size_t i = 0; i < input_images.size(); ++i) {
+          if (used[i]) continue;
+
+          std::vector<size_t> batch;
+          for (size_t j = i; j < input_images.size(); ++j) {
+            if (!used[j] && input_images[j].size() == input_images[i].size()) {
+              batch.push_back(j);
+              used[j] = true;
+            }
+          }
+
+          run(input_images, batch, results);
         }
-        else {
-          im_to_use = input_image;
+
+        return results;
+      }
+
+    private:
+      void run(const std::vector<cv::Mat>& input_images, const std::vector<size_t>& batch,
+        std::vector<std::vector<Detection>>& results) const 
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        // input tensor is reused while the batch shape is the same
+        const auto& first = input_images[batch.front()];
+        std::vector<int64_t> dims = { static_cast<int64_t>(batch.size()), first.rows, first.cols, 3 };
+        size_t frame_bytes = static_cast<size_t>(first.rows) * first.cols * 3;
+        if (!input_tensor_ || input_dims_ != dims) {
+          input_tensor_.reset(new tfwrapper::Tensor(TF_UINT8, dims, frame_bytes * batch.size()));
+          input_dims_ = dims;
+        }
+
+        // the graph expects images of type uint8, frames are written right into the tensor
+        auto data = static_cast<uint8_t*>(input_tensor_->Bytes());
+        for (size_t k = 0; k < batch.size(); ++k) {
+          const auto& image = input_images[batch[k]];
+          cv::Mat frame(first.rows, first.cols, CV_8UC3, data + k * frame_bytes);
+          if (image.channels() == 1) {
+            cv::Mat gray;
+            image.convertTo(gray, CV_8U);
+            cv::cvtColor(gray, frame, cv::COLOR_GRAY2RGB);
+          }
+          else {
+            image.convertTo(frame, CV_8U);
+          }
         }
 
-        // construct a tensor from the opencv mat (only a view)
-        tfwrapper::Tensor image_tensor(im_to_use);
-        tfwrapper::ref_vector<tfwrapper::Tensor> input_tensors{ image_tensor };
+        tfwrapper::ref_vector<tfwrapper::Tensor> input_tensors{ *input_tensor_ };
 
         // execute the graph
         std::vector<std::shared_ptr<tfwrapper::Tensor>> result_tensors;
@@ -59,33 +107,36 @@ namespace tfdetect
         const auto output_boxes = result_tensors[1]->View<float, 3>();
         const auto output_classes = result_tensors[2]->View<float, 2>();
 
-        // copy detections to the results vector
-        std::vector<Detection> results;
-        for (size_t i = 0; i < output_scores.NumElements(); ++i) {
-          if (output_scores({ 0, i }) > 0.) {
-            results.emplace_back(output_classes({ 0, i }),
-              output_scores({ 0, i }),
-              output_boxes({ 0, i, 1 }),
-              output_boxes({ 0, i, 0 }),
-              output_boxes({ 0, i, 3 }),
-              output_boxes({ 0, i, 2 }));
+        // copy detections to the results vectors
+        size_t count = output_scores.NumElements() / batch.size();
+        for (size_t k = 0; k < batch.size(); ++k) {
+          auto& dst = results[batch[k]];
+          for (size_t i = 0; i < count; ++i) {
+            if (output_scores({ k, i }) > 0.) {
+              dst.emplace_back(output_classes({ k, i }),
+                output_scores({ k, i }),
+                output_boxes({ k, i, 1 }),
+                output_boxes({ k, i, 0 }),
+                output_boxes({ k, i, 3 }),
+                output_boxes({ k, i, 2 }));
+            }
           }
         }
-
-        return results;
       }
 
-
-    private:
       std::unique_ptr<tfwrapper::Graph> graph_;
       std::unique_ptr<tfwrapper::Session> session_;
 
       std::vector<TF_Output> input_names_;
       std::vector<TF_Output> output_names_;
+
+      mutable std::mutex mutex_;
+      mutable std::unique_ptr<tfwrapper::Tensor> input_tensor_;
+      mutable std::vector<int64_t> input_dims_;
     };
   }
 
-  std::shared_ptr<Detector> CreateDetectorFromGraph(const std::string& path_to_graph_proto) {
-    return std::shared_ptr<GraphProtoDetector>(new GraphProtoDetector(path_to_graph_proto));
+  std::shared_ptr<Detector> CreateDetectorFromGraph(const std::string& path_to_graph_proto, const SessionConfig& config) {
+    return std::shared_ptr<GraphProtoDetector>(new GraphProtoDetector(path_to_graph_proto, config));
   }
 }
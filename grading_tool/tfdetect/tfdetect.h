@@ -29,13 +29,22 @@ namespace tfdetect
     }
   };
 
+  // threads of the tensorflow session (0 - chosen by tensorflow)
+  struct SessionConfig {
+    int intra_op_threads = 0;
+    int inter_op_threads = 0;
+  };
+
   class Detector
   {
   public:
     virtual ~Detector() = default;
     virtual std::vector<Detection> detect(const cv::Mat& input_image) const = 0;
+
+    // images of the same size are processed in one run
+    virtual std::vector<std::vector<Detection>> detect(const std::vector<cv::Mat>& input_images) const = 0;
   };
 
-  std::shared_ptr<Detector> CreateDetectorFromGraph(const std::string& path_to_graph_proto);
+  std::shared_ptr<Detector> CreateDetectorFromGraph(const std::string& path_to_graph_proto, const SessionConfig& config = SessionConfig());
 
 } // namespace tf_detector
@@ -2,6 +2,8 @@
 #include <fstream>
 #include <functional>
 #include <memory>
+#include <string>
+#include <vector>
 
 #include <tensorflow/c/c_api.h>
 
@@ -241,6 +243,11 @@ public:
     {}
 
     Tensor(TF_Tensor* tensor) : TFWrapper<TF_Tensor>([tensor]{return tensor;}, TF_DeleteTensor) {}
+
+    // allocate a tensor owned by tensorflow (can be reused between runs)
+    Tensor(TF_DataType dtype, const std::vector<int64_t>& dims, size_t num_bytes)
+        : TFWrapper<TF_Tensor>([&]{return TF_AllocateTensor(dtype, dims.data(), static_cast<int>(dims.size()), num_bytes);}, TF_DeleteTensor)
+    {}
     
     // inner class for convenient access to tensors' data
     template<typename DType, size_t D>
@@ -331,7 +338,6 @@ public:
         return TF_TensorByteSize(TFObj());
     }
 
-protected:
     const void* Bytes() const
     {
         return TF_TensorData(TFObj());
@@ -350,19 +356,41 @@ class SessionOptions : public TFWrapper<TF_SessionOptions>
 {
 public:
     SessionOptions() : TFWrapper<TF_SessionOptions>(TF_NewSessionOptions, TF_DeleteSessionOptions) {}
+
+    // set sizes of the session's thread pools (0 - chosen by tensorflow)
+    void SetThreads(int intra_op, int inter_op) throw(std::runtime_error)
+    {
+        // serialized ConfigProto: intra_op_parallelism_threads = 2, inter_op_parallelism_threads = 5
+        std::string config;
+        auto add_varint = [&config](int field, uint64_t value) {
+            config.push_back(static_cast<char>(field << 3));
+            do {
+                uint8_t byte = value & 0x7f;
+                value >>= 7;
+                config.push_back(static_cast<char>(value ? byte | 0x80 : byte));
+            } while (value);
+        };
+
+        if (intra_op > 0) add_varint(2, intra_op);
+        if (inter_op > 0) add_varint(5, inter_op);
+
+        Status status;
+        TF_SetConfig(TFObj(), config.data(), config.size(), status.TFObj());
+        status.ThrowRuntimeErrorIfNotOk();
+    }
 };
 
 //------------------------------------------------------------------------------
 
 namespace
 {
-// construct a session with default (empty) options.
-TF_Session* construct_session(TF_Graph* graph)
+// construct a session with specified options.
+TF_Session* construct_session(TF_Graph* graph, const TF_SessionOptions* opts)
 {
-    // TODO: check status
     Status status;
-    SessionOptions opts;
-    return TF_NewSession(graph, opts.TFObj(), status.TFObj());
+    auto session = TF_NewSession(graph, opts, status.TFObj());
+    status.ThrowRuntimeErrorIfNotOk();
+    return session;
 }
 
 // delete a session ignoring the status
@@ -376,7 +404,8 @@ void delete_session(TF_Session *session)
 class Session : public TFWrapper<TF_Session>
 {
 public:
-    Session(Graph &graph) : TFWrapper<TF_Session>(std::bind(construct_session, graph.TFObj()), delete_session) {}
+    Session(Graph &graph, const SessionOptions &opts) :
+        TFWrapper<TF_Session>(std::bind(construct_session, graph.TFObj(), opts.TFObj()), delete_session) {}
 
     void Close() throw(std::exception)
     {
@@ -391,7 +420,7 @@ public:
     {
         if (input_names.size() != input_tensors.size())
         {
-            std::runtime_error("input_names must be of same length as input_tensors!");
+            throw std::runtime_error("input_names must be of same length as input_tensors!");
         }
 
         Status status;
@@ -0,0 +1,104 @@
+#include "tiled_image_item.h"
+#include <cmath>
+#include <QPainter>
+#include <QStyleOptionGraphicsItem>
+#include <QtConcurrent>
+
+#include "viewport.h"
+
+TiledImageItem::TiledImageItem(QGraphicsItem* parent) : QGraphicsItem(parent) {
+  setFlag(QGraphicsItem::ItemUsesExtendedStyleOption);
+
+  QObject::connect(&watcher_, &QFutureWatcher<std::vector<cv::Mat>>::finished, [this] {
+    for (auto& image : watcher_.result()) {
+      levels_.push_back({ image, {} });
+    }
+
+    update();
+  });
+}
+
+void TiledImageItem::setImage(const cv::Mat& image) {
+  if (size_ != QSize(image.cols, image.rows)) {
+    prepareGeometryChange();
+    size_ = QSize(image.cols, image.rows);
+  }
+
+  levels_.clear();
+  levels_.push_back({ image, {} });
+
+  // previous result is dropped, setFuture disconnects the watcher from it
+  watcher_.setFuture(QtConcurrent::run([image] {
+    std::vector<cv::Mat> levels;
+    cv::Mat level = image;
+    while (std::max(level.cols, level.rows) > tile_size) {
+      cv::Mat next;
+      cv::resize(level, next, cv::Size((level.cols + 1) / 2, (level.rows + 1) / 2), 0, 0, cv::INTER_AREA);
+      levels.push_back(next);
+      level = next;
+    }
+
+    return levels;
+  }));
+
+  update();
+}
+
+QSize TiledImageItem::size() const {
+  return size_;
+}
+
+QRectF TiledImageItem::boundingRect() const {
+  return QRectF(QPointF(0, 0), size_);
+}
+
+int TiledImageItem::levelFor(qreal lod) const {
+  int level = 0;
+  while (level + 1 < static_cast<int>(levels_.size()) && lod * (1 << (level + 1)) >= 1.0) {
+    ++level;
+  }
+
+  return level;
+}
+
+const QPixmap& TiledImageItem::tile(int level, int x, int y) {
+  auto& l = levels_[level];
+  auto key = (quint64(y) << 32) | quint64(x);
+
+  auto it = l.tiles.find(key);
+  if (it == l.tiles.end()) {
+    cv::Rect rect(x * tile_size, y * tile_size, tile_size, tile_size);
+    rect &= cv::Rect(0, 0, l.image.cols, l.image.rows);
+    it = l.tiles.insert(key, QPixmap::fromImage(convert::cv2qt(l.image(rect))));
+  }
+
+  return it.value();
+}
+
+void TiledImageItem::paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget) {
+  Q_UNUSED(widget);
+  if (levels_.empty() || size_.isEmpty()) return;
+
+  int level = levelFor(option->levelOfDetailFromTransform(painter->worldTransform()));
+  const auto& image = levels_[level].image;
+
+  // size of level pixel in item coordinates
+  const qreal sx = qreal(size_.width()) / image.cols;
+  const qreal sy = qreal(size_.height()) / image.rows;
+
+  auto exposed = option->exposedRect.intersected(boundingRect());
+  if (exposed.isEmpty()) return;
+
+  const int x0 = static_cast<int>(exposed.left() / (sx * tile_size));
+  const int y0 = static_cast<int>(exposed.top() / (sy * tile_size));
+  const int x1 = std::min(static_cast<int>(std::ceil(exposed.right() / (sx * tile_size))), (image.cols + tile_size - 1) / tile_size);
+  const int y1 = std::min(static_cast<int>(std::ceil(exposed.bottom() / (sy * tile_size))), (image.rows + tile_size - 1) / tile_size);
+
+  for (int y = y0; y < y1; ++y) {
+    for (int x = x0; x < x1; ++x) {
+      const auto& pixmap = tile(level, x, y);
+      QRectF target(x * tile_size * sx, y * tile_size * sy, pixmap.width() * sx, pixmap.height() * sy);
+      painter->drawPixmap(target, pixmap, QRectF(pixmap.rect()));
+    }
+  }
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <vector>
+#include <QGraphicsItem>
+#include <QFutureWatcher>
+#include <QPixmap>
+#include <QHash>
+
+#include <opencv2/opencv.hpp>
+
+// Image split into square tiles at power-of-two levels of detail (levels_[0] - full resolution).
+// Only tiles intersecting the exposed area are painted, from the coarsest level which still has
+// a pixel per screen pixel, so zooming and panning don't scale the whole image every frame.
+// Coarse levels are built in background, tiles are converted to pixmaps on first paint.
+class TiledImageItem : public QGraphicsItem {
+public:
+  static const int tile_size = 256;
+
+protected:
+  struct Level {
+    cv::Mat image;
+    QHash<quint64, QPixmap> tiles;
+  };
+
+  QSize size_;
+  std::vector<Level> levels_;
+  QFutureWatcher<std::vector<cv::Mat>> watcher_;
+
+  int levelFor(qreal lod) const;
+  const QPixmap& tile(int level, int x, int y);
+
+public:
+  explicit TiledImageItem(QGraphicsItem* parent = nullptr);
+
+  // image is 8-bit gray or RGB, the item shares its data
+  void setImage(const cv::Mat& image);
+  QSize size() const;
+
+  QRectF boundingRect() const override;
+  void paint(QPainter* painter, const QStyleOptionGraphicsItem* option, QWidget* widget = nullptr) override;
+};
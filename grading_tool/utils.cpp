@@ -3,12 +3,12 @@
 namespace convert 
 {
   QImage cv2qt(cv::Mat image) {
-    const auto format = QImage::Format::Format_RGB888;
+    const auto format = image.channels() == 1 ? QImage::Format::Format_Grayscale8 : QImage::Format::Format_RGB888;
     const auto image_step = static_cast<int>(image.step);
     QImage temp(image.data, image.cols, image.rows, image_step, format);
-    temp.bits(); // force run deep copy
 
-    return temp;
+    // temp only wraps the Mat's buffer, the result must outlive the Mat
+    return temp.copy();
   }
 
   cv::Mat qt2cv(QImage const& imgsrc) {
@@ -177,6 +177,56 @@ QPointF rotatedPoint(const QPointF& pt, int angle, QSize sz, bool enabled) {
   return pt;
 }
 
+Orientation Orientation::of(int rotation, const QVector<Transformation>& transformations) {
+  Orientation ans;
+  ans.rotation = ((rotation % 360) + 360) % 360;
+
+  for (auto t : transformations) {
+    if (t == Transformation::HFlip) ans = Orientation{ 0, true } * ans;
+    else if (t == Transformation::VFlip) ans = Orientation{ 180, true } * ans; // VFlip = HFlip * Rotate180
+  }
+
+  return ans;
+}
+
+Orientation Orientation::inverse() const {
+  // flips are involutions, H * R(a) * H = R(-a)
+  if (mirrored) return *this;
+  return Orientation{ (360 - rotation) % 360, false };
+}
+
+Orientation Orientation::operator*(const Orientation& rhs) const {
+  // H^m1 * R(a1) * H^m2 * R(a2) = H^(m1 + m2) * R(+-a1 + a2)
+  auto angle = (rhs.mirrored ? 360 - rotation : rotation) + rhs.rotation;
+  return Orientation{ angle % 360, mirrored != rhs.mirrored };
+}
+
+bool Orientation::operator==(const Orientation& rhs) const {
+  return rotation == rhs.rotation && mirrored == rhs.mirrored;
+}
+
+bool Orientation::operator!=(const Orientation& rhs) const {
+  return !(*this == rhs);
+}
+
+void applyOrientation(const cv::Mat& src, cv::Mat& dst, const Orientation& o) {
+  if (!o.mirrored) {
+    if (o.rotation == 90) cv::rotate(src, dst, cv::ROTATE_90_CLOCKWISE);
+    else if (o.rotation == 180) cv::flip(src, dst, -1);
+    else if (o.rotation == 270) cv::rotate(src, dst, cv::ROTATE_90_COUNTERCLOCKWISE);
+    else dst = src;
+  }
+  else {
+    if (o.rotation == 90) cv::transpose(src, dst);
+    else if (o.rotation == 180) cv::flip(src, dst, 0);
+    else if (o.rotation == 270) { // anti-transpose
+      cv::transpose(src, dst);
+      cv::flip(dst, dst, -1);
+    }
+    else cv::flip(src, dst, 1);
+  }
+}
+
 qreal dist(const QPointF& p1, const QPointF& p2) {
   return std::sqrt((p1.x() - p2.x()) * (p1.x() - p2.x()) + (p1.y() - p2.y()) * (p1.y() - p2.y()));
 }
@@ -202,33 +252,6 @@ QPointF str2point(const QString& str) {
   return QPointF(vals[0].toDouble(), vals[1].toDouble());
 }
 
-qreal perimeter(const QPolygonF& poly) {
-  qreal acc = 0.0f;
-  acc += dist(poly.last(), poly.first());
-  for (int k = 1; k < poly.count(); ++k) {
-    acc += dist(poly[k - 1], poly[k]);
-  }
-
-  return acc;
-}
-
-qreal square(const QPolygonF& poly) {
-  int count = 0;
-  auto rect = poly.boundingRect();
-  int left = qMax<int>(0, qMin(rect.x(), rect.x() + rect.width()));
-  int bottom = qMax<int>(0, qMin(rect.y(), rect.y() + rect.height()));
-  int right = left + qAbs<int>(rect.width()), top = bottom + qAbs(rect.height());
-  for (int i = left; i <= right; ++i) {
-    for (int j = bottom; j <= top; ++j) {
-      if (poly.containsPoint(QPointF(i, j), Qt::FillRule::OddEvenFill)) {
-        count += 1;
-      }
-    }
-  }
-
-  return count;
-}
-
 cv::Rect rect(const xr::contour_t& contour) {
   int left = INT_MAX, right = 0, bottom = INT_MAX, top = 0;
   for (int k = 0; k < contour.size(); ++k) {
@@ -241,20 +264,6 @@ cv::Rect rect(const xr::contour_t& contour) {
   return cv::Rect(left, bottom, right - left, top - bottom);
 }
 
-qreal max_width(const xr::contour_t& contour) {
-  qreal ans = 0.0;
-  for (int k = 0; k < contour.size(); ++k) {
-    int current_y = contour[k].y;
-    for (int k2 = 0; k2 < contour.size(); ++k2) {
-      if (k != k2 && contour[k2].y == current_y) {
-        ans = qMax<qreal>(ans, qAbs(contour[k2].x - contour[k].x));
-      }
-    }
-  }
-
-  return ans;
-}
-
 qreal jaccard(const cv::Rect& lhs, const cv::Rect& rhs) {
   return  (lhs & rhs).area() * 1.0 / (lhs | rhs).area();
 }
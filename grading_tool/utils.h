@@ -1,8 +1,12 @@
 #pragma once
 #include <QImage>
+#include <QPointF>
+#include <QVector>
 #include <opencv2/opencv.hpp>
 #include <defs.h>
 
+#include "types.h"
+
 template<class T>
 T sqr(T value) {
   return value * value;
@@ -14,11 +18,25 @@ cv::Mat gvf(cv::Mat src, double mu, int iters);
 
 QPointF rotatedPoint(const QPointF& pt, int angle, QSize pixmap_size, bool enable = true);
 
+// Element of the symmetry group of a square: clockwise rotation followed by optional horizontal flip.
+// Any sequence of rotations and flips collapses into one element, so the image is remapped once.
+struct Orientation {
+  int rotation = 0; // 0, 90, 180 or 270
+  bool mirrored = false;
+
+  static Orientation of(int rotation, const QVector<Transformation>& transformations);
+
+  Orientation inverse() const;
+  Orientation operator*(const Orientation& rhs) const; // rhs is applied first
+  bool operator==(const Orientation& rhs) const;
+  bool operator!=(const Orientation& rhs) const;
+};
+
+// dst may share data with src for the identity
+void applyOrientation(const cv::Mat& src, cv::Mat& dst, const Orientation& o);
+
 qreal dist(const QPointF& p1, const QPointF& p2);
 qreal distToLine(const QPointF& p, const QPointF& pa, const QPointF& pb);
-qreal perimeter(const QPolygonF& p);
-qreal square(const QPolygonF& p);
-qreal max_width(const xr::contour_t& contour);
 cv::Rect rect(const xr::contour_t& contour);
 qreal jaccard(const cv::Rect& lhs, const cv::Rect& rhs);
 
@@ -12,6 +12,8 @@
 #include <QLabel>
 #include <QDebug>
 #include <QMenu>
+#include <QFutureWatcher>
+#include <QtConcurrent>
 
 #include "utils.h"
 
@@ -31,6 +33,9 @@ ViewQueue::ViewQueue(QWidget* parent) :
 
   connect(this, &QTableWidget::itemSelectionChanged, this, &ViewQueue::itemSelectionChanged);
   connect(this, &QTableWidget::cellClicked, this, &ViewQueue::itemClicked);
+  connect(horizontalScrollBar(), &QScrollBar::valueChanged, [this](int) {
+    renderVisible();
+  });
 
   qRegisterMetaType<Metadata::HardPtr>("Metadata::HardPtr");
 }
@@ -42,13 +47,11 @@ void ViewQueue::resizeEvent(QResizeEvent* event) {
 
   const auto s = getIconHeight();
   for (int i = 0; i < columnCount(); ++i) {
-    if (auto l = cellWidget(0, i)->findChild<QLabel*>("View")) {
-      l->setPixmap(QPixmap::fromImage(cv2qt(data_[i]->image)).scaledToHeight(s));
-    }
+    setColumnWidth(i, columnWidthFor(i, s));
   }
 
-  resizeColumnsToContents();
-  resizeRowsToContents();
+  setRowHeight(0, viewport()->height());
+  renderVisible();
 }
 
 void ViewQueue::keyPressEvent(QKeyEvent* e) {
@@ -61,14 +64,93 @@ void ViewQueue::keyPressEvent(QKeyEvent* e) {
 }
 
 void ViewQueue::updateView() {
+  renderVisible();
+}
+
+void ViewQueue::renderVisible() {
+  if (columnCount() == 0) return;
+
   const auto s = getIconHeight();
-  for (int i = 0; i < columnCount(); ++i) {
+  const auto first = qMax(0, columnAt(0));
+  auto last = columnAt(viewport()->width() - 1);
+  if (last < 0) last = columnCount() - 1;
+
+  for (int i = first; i <= last; ++i) {
+    auto item = data_[i].get();
+    auto& thumb = thumbnails_[item];
+    if (thumb.revision != item->revision) {
+      requestThumbnail(i);
+    }
+
+    if (thumb.image.isNull()) continue;
+
+    if (thumb.pixmap.isNull() || thumb.pixmap.height() != s) {
+      thumb.pixmap = QPixmap::fromImage(thumb.image).scaledToHeight(s, Qt::SmoothTransformation);
+    }
+
     auto l = cellWidget(0, i)->findChild<QLabel*>("View");
-    l->setPixmap(QPixmap::fromImage(cv2qt(data_[i]->image)).scaledToHeight(s));
+    if (!l->pixmap() || l->pixmap()->cacheKey() != thumb.pixmap.cacheKey()) {
+      l->setPixmap(thumb.pixmap);
+    }
   }
+}
 
-  resizeColumnsToContents();
-  resizeRowsToContents();
+void ViewQueue::requestThumbnail(int idx) {
+  auto item = data_[idx];
+  auto& thumb = thumbnails_[item.get()];
+
+  // items spilled to disk keep the last thumbnail
+  if (thumb.pending || item->image.empty()) return;
+  thumb.pending = true;
+
+  // item may be changed while the thumbnail is made, so take copies
+  auto image = item->image;
+  auto orientation = Orientation::of(item->rotation, item->transformations);
+  auto revision = item->revision;
+
+  // watcher lives in GUI thread and is deleted with the queue, so the worker never touches it
+  auto watcher = new QFutureWatcher<QImage>(this);
+  connect(watcher, &QFutureWatcher<QImage>::finished, this, [this, watcher, item, revision]() {
+    onThumbnailReady(item, revision, watcher->result());
+    watcher->deleteLater();
+  });
+
+  watcher->setFuture(QtConcurrent::run([image, orientation]() {
+    cv::Mat sample;
+    auto factor = thumbnail_height * 1.0 / image.rows;
+    if (factor < 1.0) cv::resize(image, sample, cv::Size(), factor, factor, cv::INTER_AREA);
+    else sample = image.clone();
+
+    applyOrientation(sample, sample, orientation);
+    return cv2qt(sample);
+  }));
+}
+
+void ViewQueue::onThumbnailReady(Metadata::HardPtr item, int revision, const QImage& image) {
+  auto it = thumbnails_.find(item.get());
+  if (it == thumbnails_.end()) return; // removed meanwhile
+
+  it->pending = false;
+  it->revision = revision;
+  it->image = image;
+  it->size = image.size();
+  it->pixmap = QPixmap();
+
+  auto idx = data_.indexOf(item);
+  if (idx >= 0) {
+    setColumnWidth(idx, columnWidthFor(idx, getIconHeight()));
+  }
+
+  renderVisible();
+}
+
+int ViewQueue::columnWidthFor(int idx, int icon_height) const {
+  auto size = thumbnails_.value(data_[idx].get()).size;
+  auto icon_width = size.isEmpty() ? icon_height : icon_height * size.width() / size.height();
+  auto title_width = fontMetrics().width(data_[idx]->filename);
+
+  // margins of the label and the layout
+  return qMax(icon_width, title_width) + 12;
 }
 
 int ViewQueue::getIconHeight() const {
@@ -85,7 +167,6 @@ void ViewQueue::set(int idx) {
   view->setObjectName("View");
   view->setAlignment(Qt::AlignCenter);
   view->setContentsMargins(4, 0, 4, 8);
-  view->setPixmap(QPixmap::fromImage(cv2qt(data_[idx]->image)).scaledToHeight(getIconHeight()));
 
   auto title = new QLabel(data_[idx]->filename, w);
   title->setAlignment(Qt::AlignHCenter | Qt::AlignVCenter);
@@ -113,11 +194,9 @@ void ViewQueue::select(int idx, bool emitSignal) {
 }
 
 void ViewQueue::remove(int col) {
+  thumbnails_.remove(data_[col].get());
   data_.removeAt(col);
-  setColumnCount(columnCount() - 1);
-  for (int i = col; i < data_.size(); ++i) {
-    set(i);
-  }
+  removeColumn(col);
 
   auto ranges = selectedRanges();
   if (ranges.isEmpty() || ranges.front().leftColumn() < 0) {
@@ -142,9 +221,10 @@ void ViewQueue::addItem(Metadata::HardPtr item) {
   setColumnCount(nextCol + 1);
 
   set(nextCol);
+  requestThumbnail(nextCol);
 
-  resizeColumnsToContents();
-  resizeRowsToContents();
+  setColumnWidth(nextCol, columnWidthFor(nextCol, getIconHeight()));
+  setRowHeight(0, viewport()->height());
 
   setCurrentCell(0, nextCol);
 }
@@ -153,6 +233,10 @@ int ViewQueue::count() const {
   return data_.size();
 }
 
+QList<Metadata::HardPtr> ViewQueue::items() const {
+  return data_;
+}
+
 void ViewQueue::itemSelectionChanged() {
   const auto col = currentItemIdx();
   if (col >= 0) {
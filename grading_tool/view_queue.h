@@ -1,5 +1,8 @@
 #pragma once
 #include <QTableWidget>
+#include <QPixmap>
+#include <QImage>
+#include <QHash>
 
 #include "metadata.h"
 
@@ -9,10 +12,25 @@ class ViewQueue : public QTableWidget {
   Q_OBJECT
 
 private:
+  // thumbnail is made once in background, the pixmap is rescaled only when the icon height changes
+  struct Thumbnail {
+    int revision = -1; // revision of the item the thumbnail is made for
+    bool pending = false;
+    QSize size;        // size of the transformed image (for columns width)
+    QImage image;      // downscaled and transformed image
+    QPixmap pixmap;    // image scaled to the icon height
+  };
+
+  static const int thumbnail_height = 256;
+
   QList<QLabel*> labels_;
   QList<Metadata::HardPtr> data_;
+  QHash<Metadata*, Thumbnail> thumbnails_;
 
   int getIconHeight() const;
+  int columnWidthFor(int idx, int icon_height) const;
+  void requestThumbnail(int idx);
+  void renderVisible();
 
 protected:
   void resizeEvent(QResizeEvent* event) override;
@@ -25,11 +43,13 @@ protected:
 
   Q_SLOT void itemSelectionChanged();
   Q_SLOT void itemClicked(int row, int column);
+  Q_SLOT void onThumbnailReady(Metadata::HardPtr item, int revision, const QImage& image);
 
 public:
   ViewQueue(QWidget* parent = nullptr);
 
   int count() const;
+  QList<Metadata::HardPtr> items() const;
   int currentItemIdx() const;
 
   Q_SLOT void addItem(Metadata::HardPtr item);
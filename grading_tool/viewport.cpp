@@ -1,7 +1,6 @@
 #include "viewport.h"
 #include <QApplication>
 #include <QMainWindow>
-#include <QGraphicsPixmapItem>
 #include <QWheelEvent>
 #include <QScrollBar>
 #include <QPixmap>
@@ -13,6 +12,7 @@
 #include <QPainter>
 
 #include "utils.h"
+#include "tiled_image_item.h"
 
 const QColor colors[] = {
    QColor(Qt::red),
@@ -56,8 +56,8 @@ Viewport::Mode Viewport::mode() const {
 ViewportState Viewport::state() const {
   ViewportState s;
   s.scale = scale_factor_;
-  if (pixmap_item_) {
-    s.position = pixmap_item_->pos();
+  if (image_item_) {
+    s.position = image_item_->pos();
   }
 
   return s;
@@ -77,15 +77,16 @@ int Viewport::removeGraphicsItem(GraphicsItem* item) {
 }
 
 void Viewport::scaleTo(qreal factor) {
-  auto prev_pos = QPoint((width() - last_pixmap_.width() * scale_factor_) * 0.5, (height() - last_pixmap_.height() * scale_factor_) * 0.5);
+  const auto sz = image_item_->size();
+  auto prev_pos = QPoint((width() - sz.width() * scale_factor_) * 0.5, (height() - sz.height() * scale_factor_) * 0.5);
   auto prev_scale_factor = scale_factor_;
 
   scale_factor_ = factor;
 
-  auto new_pos = QPoint((width() - last_pixmap_.width() * scale_factor_) * 0.5, (height() - last_pixmap_.height() * scale_factor_) * 0.5);
+  auto new_pos = QPoint((width() - sz.width() * scale_factor_) * 0.5, (height() - sz.height() * scale_factor_) * 0.5);
 
-  pixmap_item_->setScale(scale_factor_);
-  pixmap_item_->setPos(pixmap_item_->pos() + (new_pos - prev_pos));
+  image_item_->setScale(scale_factor_);
+  image_item_->setPos(image_item_->pos() + (new_pos - prev_pos));
 
   for (auto item : graphics_items_) {
     item->setScaleFactor(scale_factor_);
@@ -133,13 +134,20 @@ void Viewport::setMode(Viewport::Mode mode) {
 
 void Viewport::setState(ViewportState state) {
   scale_factor_ = state.scale;
-  pixmap_item_->setScale(scale_factor_);
-  pixmap_item_->setPos(state.position);
+  image_item_->setScale(scale_factor_);
+  image_item_->setPos(state.position);
 }
 
 void Viewport::setGraphicsItems(const QJsonArray& items, const QVector<Transformation>& t, int r) {
+  // remove previous graphics items
+  for (auto item : graphics_items_) {
+    scene()->removeItem(item);
+  }
+
+  graphics_items_.clear();
+
   for (auto json : items) {
-    auto item = GraphicsItem::makeFromJson(json.toObject(), t, r, pixmap_item_);
+    auto item = GraphicsItem::makeFromJson(json.toObject(), t, r, image_item_);
     item->setCalibrationCoef(calib_coef_);
     item->setScaleFactor(scale_factor_);
     item->setCreated(true);
@@ -151,7 +159,7 @@ void Viewport::setGraphicsItems(const QJsonArray& items, const QVector<Transform
 }
 
 void Viewport::addNewSmartCurve(const QVector<QPoint>& points) {
-  auto item = GraphicsItem::makeSmartCurve(points.first(), pixmap_item_);
+  auto item = GraphicsItem::makeSmartCurve(points.first(), image_item_);
   item->setCalibrationCoef(calib_coef_);
   item->setScaleFactor(scale_factor_);
   item->setGradient(gradient_);
@@ -177,25 +185,22 @@ void Viewport::setLabelVisible(bool visible) {
   }
 }
 
-void Viewport::setImage(const QImage& image) {
-  resetCalibrationCoef();
-
-  // remove previous graphics items
-  for (auto item : graphics_items_) {
-    scene()->removeItem(item);
+void Viewport::setImage(const cv::Mat& image, int rotation) {
+  rotation_ = rotation;
+  if (image.type() != CV_8UC3) {
+    cv::cvtColor(image, image_, cv::COLOR_GRAY2RGB);
+  }
+  else {
+    image_ = image;
   }
-
-  graphics_items_.clear();
-  // clicks_counter_ = 0;
-  // drawing_ = false;
 
   // если изменился размер изображения
-  if (!last_pixmap_.isNull() && last_pixmap_.size() != image.size()) {
+  if (image_item_ && image_item_->size() != QSize(image.cols, image.rows)) {
     clearScene();
+    graphics_items_.clear();
+    joints_items_.clear();
   }
 
-  last_pixmap_ = QPixmap::fromImage(image);
-
   if (!scene()) {
     auto s = new QGraphicsScene();
     s->setBackgroundBrush(QBrush(qRgb(0, 0, 0)));
@@ -203,12 +208,13 @@ void Viewport::setImage(const QImage& image) {
     QGraphicsView::setScene(s);
     setStyleSheet("");
 
-    pixmap_item_ = scene()->addPixmap(last_pixmap_);
+    image_item_ = new TiledImageItem();
+    s->addItem(image_item_);
     s->addItem(label_);
   }
-  else {
-    pixmap_item_->setPixmap(last_pixmap_);
-  }
+
+  // the pyramid is built from the source plane, gray images stay single-channel
+  image_item_->setImage(image);
 }
 
 void Viewport::setJoints(const QVector<Metadata::Joint>& joints, const QVector<Transformation>& transforms, int r) {
@@ -221,9 +227,9 @@ void Viewport::setJoints(const QVector<Metadata::Joint>& joints, const QVector<T
   }
   
   int counter = 0;
-  auto sz = pixmap_item_->pixmap().size();
+  auto sz = image_item_->size();
   for (auto joint : joints) {
-    auto item = new QGraphicsRectItem(pixmap_item_);
+    auto item = new QGraphicsRectItem(image_item_);
     auto rect = QRectF(joint.rect.x, joint.rect.y, joint.rect.size().width, joint.rect.size().height);
     auto tl = rotatedPoint(rect.topLeft(), r, sz), br = rotatedPoint(rect.bottomRight(), r, sz);
 
@@ -246,16 +252,17 @@ void Viewport::setJoints(const QVector<Metadata::Joint>& joints, const QVector<T
 }
 
 void Viewport::fitImageToViewport() {
-  if (!last_pixmap_.isNull() && scene()) {
+  if (image_item_ && !image_item_->size().isEmpty() && scene()) {
+    const auto sz = image_item_->size();
     scale_factor_ = qMin(
-      double(width()) / last_pixmap_.width() * 0.95,
-      double(height()) / last_pixmap_.height() * 0.95);
+      double(width()) / sz.width() * 0.95,
+      double(height()) / sz.height() * 0.95);
 
-    auto w2 = last_pixmap_.width() * scale_factor_;
-    auto h2 = last_pixmap_.height() * scale_factor_;
+    auto w2 = sz.width() * scale_factor_;
+    auto h2 = sz.height() * scale_factor_;
 
-    pixmap_item_->setScale(scale_factor_);
-    pixmap_item_->setPos((width() - w2) * 0.5, (height() - h2) * 0.5);
+    image_item_->setScale(scale_factor_);
+    image_item_->setPos((width() - w2) * 0.5, (height() - h2) * 0.5);
 
     for (auto item : graphics_items_) {
       item->setScaleFactor(scale_factor_);
@@ -263,19 +270,6 @@ void Viewport::fitImageToViewport() {
   }
 }
 
-void Viewport::setImage(const cv::Mat& image, int rotation) {
-  rotation_ = rotation;
-
-  if (image.type() != CV_8UC3) {
-    cv::cvtColor(image, image_, cv::COLOR_GRAY2RGB);
-    setImage(convert::cv2qt(image_));
-  }
-  else {
-    image_ = image;
-    setImage(convert::cv2qt(image));
-  }
-}
-
 void Viewport::setGradient(const cv::Mat& gradient) {
   gradient_ = gradient;
 }
@@ -284,12 +278,13 @@ void Viewport::clearScene() {
   setStyleSheet("background-color: black;");
   if (auto s = scene()) {
     for (auto item : s->items()) {
-      if (!dynamic_cast<QGraphicsPixmapItem*>(item)) {
+      if (item != image_item_) {
         s->removeItem(item);
       }
     }
 
     delete s;
+    image_item_ = nullptr;
 
     QGraphicsView::setScene(nullptr);
   }
@@ -357,7 +352,7 @@ void Viewport::mouseDoubleClickEvent(QMouseEvent* event) {
   if (!scene()) return;
 
   auto point = mapToScene(event->pos());
-  auto coord = QPointF(point - pixmap_item_->pos()) / scale_factor_;
+  auto coord = QPointF(point - image_item_->pos()) / scale_factor_;
   if (event->button() == Qt::LeftButton) {
     if (drawing_) {
       if (mode_ == Mode::DrawPoly) {
@@ -422,22 +417,22 @@ void Viewport::mousePressEvent(QMouseEvent* event) {
   if (!scene()) return;
 
   auto point = mapToScene(event->pos());
-  auto rect = QRectF(pixmap_item_->pos() + QPointF(1, 1), (last_pixmap_.size() - QSize(2, 2)) * scale_factor_);
+  auto rect = QRectF(image_item_->pos() + QPointF(1, 1), (image_item_->size() - QSize(2, 2)) * scale_factor_);
   if (rect.contains(point)) {
-    emit signalOnClick(point - pixmap_item_->pos());
+    emit signalOnClick(point - image_item_->pos());
   }
 
   if (event->button() == Qt::RightButton) {
     if (rect.contains(point)) {
-      anchor_shift_ = pixmap_item_->pos() - point;
+      anchor_shift_ = image_item_->pos() - point;
       setCursor(Qt::ClosedHandCursor);
     }
   }
   else if (event->button() == Qt::LeftButton) {
     GraphicsItem* item = nullptr;
-    auto coord = QPointF(point - pixmap_item_->pos()) / scale_factor_;
+    auto coord = QPointF(point - image_item_->pos()) / scale_factor_;
     if (mode_ == Mode::Calibrate) {
-      item = GraphicsItem::makeLine(coord, coord, pixmap_item_);
+      item = GraphicsItem::makeLine(coord, coord, image_item_);
       item->setScaleFactor(scale_factor_);
       item->setFixedColor(Qt::blue);
 
@@ -479,21 +474,21 @@ void Viewport::mousePressEvent(QMouseEvent* event) {
           }
         }
         else if (mode_ == Mode::DrawLine) {
-          item = GraphicsItem::makeLine(coord, coord, pixmap_item_);
+          item = GraphicsItem::makeLine(coord, coord, image_item_);
           item->setCalibrationCoef(calib_coef_);
           item->setScaleFactor(scale_factor_);
           graphics_items_.push_back(item);
           drawing_ = true;
         }
         else if (mode_ == Mode::DrawAngle) {
-          item = GraphicsItem::makeAngle(coord, pixmap_item_);
+          item = GraphicsItem::makeAngle(coord, image_item_);
           item->setCalibrationCoef(calib_coef_);
           item->setScaleFactor(scale_factor_);
           graphics_items_.push_back(item);
           drawing_ = true;
         }
         else if (mode_ == Mode::DrawCobbAngle) {
-          item = GraphicsItem::makeCobbAngle(coord, pixmap_item_);
+          item = GraphicsItem::makeCobbAngle(coord, image_item_);
           item->setCalibrationCoef(calib_coef_);
           item->setScaleFactor(scale_factor_);
           graphics_items_.push_back(item);
@@ -501,21 +496,21 @@ void Viewport::mousePressEvent(QMouseEvent* event) {
           drawing_ = true;
         }
         else if (mode_ == Mode::DrawPoly) {
-          item = GraphicsItem::makePoly(coord, pixmap_item_);
+          item = GraphicsItem::makePoly(coord, image_item_);
           item->setCalibrationCoef(calib_coef_);
           item->setScaleFactor(scale_factor_);
           graphics_items_.push_back(item);
           drawing_ = true;
         }
         else if (mode_ == Mode::DrawCircle) {
-          item = GraphicsItem::makeEllipse(coord, coord, pixmap_item_);
+          item = GraphicsItem::makeEllipse(coord, coord, image_item_);
           item->setCalibrationCoef(calib_coef_);
           item->setScaleFactor(scale_factor_);
           graphics_items_.push_back(item);
           drawing_ = true;
         }
         else if (mode_ == Mode::SmartCurve) {
-          item = GraphicsItem::makeSmartCurve(coord, pixmap_item_);
+          item = GraphicsItem::makeSmartCurve(coord, image_item_);
           item->setCalibrationCoef(calib_coef_);
           item->setScaleFactor(scale_factor_);
           item->setGradient(gradient_);
@@ -541,10 +536,10 @@ void Viewport::mouseReleaseEvent(QMouseEvent* event) {
   setCursor(Qt::ArrowCursor);
 
   auto point = mapToScene(event->pos());
-  auto coord = QPointF(point - pixmap_item_->pos()) / scale_factor_;
+  auto coord = QPointF(point - image_item_->pos()) / scale_factor_;
   if (event->button() == Qt::RightButton) {
-    if (pixmap_item_) {
-      auto next_shift = pixmap_item_->pos() - point;
+    if (image_item_) {
+      auto next_shift = image_item_->pos() - point;
       if (!anchor_shift_ || (next_shift - anchor_shift_.value()).manhattanLength() <= 2) {
         for (int k = 0; k < graphics_items_.size(); ++k) {
           if (graphics_items_[k]->isItemUnderMouse()) {
@@ -664,19 +659,19 @@ void Viewport::mouseMoveEvent(QMouseEvent* event) {
   if (!scene()) return;
 
   auto point = mapToScene(event->pos());
-  auto rect = QRectF(pixmap_item_->pos() + QPointF(1, 1), (last_pixmap_.size() - QSize(2, 2)) * scale_factor_);
-  if (pixmap_item_ && anchor_shift_) { // move image
+  auto rect = QRectF(image_item_->pos() + QPointF(1, 1), (image_item_->size() - QSize(2, 2)) * scale_factor_);
+  if (image_item_ && anchor_shift_) { // move image
     if (rect.contains(point)) {
       auto pt = anchor_shift_.value() + point;
-      if ((pt - pixmap_item_->pos()).manhattanLength() > 3) {
-        auto shift = pt - pixmap_item_->pos();
-        pixmap_item_->setPos(pt);
+      if ((pt - image_item_->pos()).manhattanLength() > 3) {
+        auto shift = pt - image_item_->pos();
+        image_item_->setPos(pt);
         repaint();
       }
     }
   }
-  else if (pixmap_item_) {
-    auto coord = QPointF(point - pixmap_item_->pos()) / scale_factor_;
+  else if (image_item_) {
+    auto coord = QPointF(point - image_item_->pos()) / scale_factor_;
     if (drawing_) {
       if (!graphics_items_.isEmpty() && rect.contains(point)) {
         auto item = graphics_items_.last();
@@ -13,7 +13,7 @@
 
 class QPushButton;
 class QHBoxLayout;
-class QGraphicsPixmapItem;
+class TiledImageItem;
 
 namespace convert {
   QImage cv2qt(cv::Mat image);
@@ -41,9 +41,8 @@ protected:
   cv::Mat image_;
   cv::Mat gradient_;
   int rotation_ = 0;
-  QPixmap last_pixmap_;
   QGraphicsTextItem* label_ = nullptr;
-  QGraphicsPixmapItem* pixmap_item_ = nullptr;
+  TiledImageItem* image_item_ = nullptr;
   QList<QGraphicsRectItem*> joints_items_;
   QList<GraphicsItem*> graphics_items_;
   std::optional<qreal> calib_coef_;
@@ -71,7 +70,7 @@ public:
   void setMode(Mode mode);
   void setState(ViewportState state);
 
-  // add graphics items to viewport
+  // replace graphics items of viewport
   // @param items:  list of encoded graphics items
   // @param t:      transformations set of current image
   // @param r:      rotation of current image
@@ -91,9 +90,9 @@ public:
   void resetCalibrationCoef();
   void setCalibrationCoef(std::optional<qreal> coef);
   int removeGraphicsItem(GraphicsItem* item);
+  // graphics items are kept unless the image size changes
   void setImage(const cv::Mat& image, int rotation = 0);
   void setGradient(const cv::Mat& gradient);
-  void setImage(const QImage& image);
   void setJoints(const QVector<Metadata::Joint>& joints, const QVector<Transformation>& t, int r);
 
   void resizeEvent(QResizeEvent* event) override;